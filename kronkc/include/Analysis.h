@@ -0,0 +1,24 @@
+#ifndef _ANALYSIS_H_
+#define _ANALYSIS_H_
+
+#include "Nodes.h"
+
+
+namespace analysis {
+
+
+std::unordered_set<std::string> findIntegralVars(const std::vector<std::unique_ptr<Node>>& stmts,
+                                                 const std::vector<std::string>& params = {});
+
+bool isIntegralExpr(Node* expr);
+
+Value* emitIntegralExpr(Node* expr);
+
+FunctionCallExpr* getSelfTailCall(Node* stmt, const std::string& fnName);
+
+bool hasSelfTailCall(const std::vector<std::unique_ptr<Node>>& stmts, const std::string& fnName);
+
+
+}  // namespace analysis
+
+#endif
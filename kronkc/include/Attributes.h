@@ -1,6 +1,8 @@
 #ifndef _ATTRIBUTES_H_
 #define _ATTRIBUTES_H_
 
+#include <functional>
+
 #include "IRGen.h"
 
 
@@ -12,6 +14,22 @@ class SuspendedModuleState;
 namespace Attr {
 extern bool PRINT_DEBUG_INFO;
 extern bool INCLUDE_MODE;
+extern bool CACHE_STATS;
+extern bool INLINE_RUNTIME;
+extern bool SANS_VERIFICATIONS;
+extern std::string VECLIB;
+extern bool RAPIDE_MATH;
+extern bool SANS_NAN_INF;
+extern std::unordered_set<std::string> EXPORTS;
+extern std::string OPT_LEVEL;
+extern std::string PASSES;
+extern bool TIME_PASSES;
+extern bool TIERED;
+extern bool LAZY_OPTIMIZE;
+extern unsigned JIT_THREADS;
+extern std::string JIT_PARTITION;
+extern bool SPECULATE;
+extern bool ALLOC_STATS;
 
 ////////////////////// module specific attributes /////////////////////////////////
 extern std::unique_ptr<llvm::Module> ThisModule;
@@ -22,6 +40,8 @@ extern std::unordered_map<std::string, StructType*> EntityTypes;
 extern size_t CurrentLexerLine;
 extern std::vector<std::unique_ptr<Scope>> ScopeStack;
 
+extern uint32_t SourceFileId;
+
 extern std::vector<std::string> Dependencies;
 //////////////////////////////////////////////////////////////////////////////////
 
@@ -30,6 +50,7 @@ extern std::vector<std::unique_ptr<SuspendedModuleState>> SuspendedModuleStack;
 
 extern std::unordered_map<std::string, std::string> DuplicateModuleMap;
 extern std::map<fs::path, std::string> FileToModuleIdMap;
+extern std::vector<std::string> SourceFiles;
 
 
 extern llvm::LLVMContext Context;
@@ -40,6 +61,18 @@ extern const std::unordered_set<std::string> KronkrtModules;
 
 extern const std::unordered_map<std::string, std::string> DirectFunctions;
 
+extern const std::unordered_set<std::string> ListFunctions;
+
+extern const std::unordered_set<std::string> ConversionFunctions;
+
+extern const std::unordered_set<std::string> FunctionAnnotations;
+
+extern const std::unordered_map<std::string, Intrinsic::ID> MathIntrinsics;
+
+extern const std::unordered_map<std::string, std::string> VecLibs;
+
+extern const std::unordered_set<std::string> JitPartitions;
+
 extern const std::unordered_set<std::string> BuiltinTypes;
 
 extern const std::unordered_map<std::string, uint8_t> KronkOperators;
@@ -48,6 +81,7 @@ extern const std::unordered_set<std::string> RelationalOps;
 extern const std::unordered_set<std::string> RightAssociativeOps;
 
 extern size_t IRGenLineOffset;
+extern std::function<void()> BeforeCompileError;
 
 }  // namespace Attr
 
@@ -84,6 +118,7 @@ struct SuspendedModuleState : public ModuleAttrs {
 
 	size_t CurrentLexerLine;
 	std::vector<std::unique_ptr<Scope>> ScopeStack;
+	uint32_t SourceFileId;
 
 	SuspendedModuleState(std::unique_ptr<llvm::Module> ThisModule)
 	    : ModuleAttrs(std::move(ThisModule)) {}
@@ -91,6 +126,7 @@ struct SuspendedModuleState : public ModuleAttrs {
 
 
 void LogProgress(std::string str);
+void LogEarlierErrors();
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef _BOUNDS_CHECK_ELIM_H
+#define _BOUNDS_CHECK_ELIM_H
+
+#include <llvm/IR/PassManager.h>
+
+#include "Attributes.h"
+
+
+// Removes the bounds checks of liste indexing (see irGenAide::emitListIdxCheck) that can be proven to
+// always pass, and hoists the loop invariant ones out of their loops.
+class BoundsCheckElimPass : public llvm::PassInfoMixin<BoundsCheckElimPass> {
+public:
+	llvm::PreservedAnalyses run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM);
+};
+
+
+#endif
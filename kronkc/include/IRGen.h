@@ -33,8 +33,8 @@ public:
 	// (i.e Nodes allowed on the left hand side of an assigment) override this method.
 	virtual bool injectCtx(bool ctx) { return false; }
 
-	virtual std::unique_ptr<Node> clone(){};
-	virtual Value* codegen(){};
+	virtual std::unique_ptr<Node> clone() { return nullptr; }
+	virtual Value* codegen() { return nullptr; }
 	virtual ~Node() {}
 };
 
@@ -47,6 +47,44 @@ public:
 	// record of all heap allocations for this scope
 	std::vector<Value*> HeapAllocas;
 
+	// the slices made in the function, each with the slot holding it once it's made. A slice refers to
+	// the data block of its liste, and drops the reference when it dies (see irGenAide::emitDropViews)
+	std::vector<std::pair<Value*, AllocaInst*>> Views;
+
+	// a loop enclosing the current insertion point, see irGenAide::beginIteration
+	struct Iteration {
+		BasicBlock* headerBB;  // where each iteration starts
+		// the HeapAllocas and the Views from these indices on are made by the iteration
+		size_t firstHeapAlloca;
+		size_t firstView;
+		// whether the iteration allocates from the arena, and whether that memory may be stored where it
+		// outlives the iteration
+		bool allocates = false;
+		bool escapes = false;
+		std::vector<BranchInst*> backEdges;  // the branches to the next iteration
+	};
+
+	// the loops enclosing the current insertion point, innermost last. Memory allocated inside a loop
+	// must be fresh on every iteration, so it can't come from an alloca hoisted to the entry block.
+	std::vector<Iteration> Iterations;
+
+	// position of the runtime's arena when the function was entered. Everything the function allocated
+	// from the arena is released when it returns.
+	Value* arenaMark = nullptr;
+
+	// reel variables that only ever hold integers. They are kept in i64s, see analysis::findIntegralVars
+	std::unordered_set<std::string> IntegralVars;
+
+	// block reporting the runtime checks that failed in the function. Created by the first check.
+	BasicBlock* trapBB = nullptr;
+
+	// where the arguments of the function are stored, in order
+	std::vector<Value*> ParamAllocas;
+
+	// block right after the arguments are stored, where self tail calls jump back to. Only set if the
+	// function has self tail calls, see analysis::hasSelfTailCall
+	BasicBlock* tailRecurseBB = nullptr;
+
 	// last block in a function definition.
 	BasicBlock* fnExitBB;
 	// holds return value for function. Helps to handle multiple return values in function definition
@@ -14,8 +14,42 @@ Value* DoubletoIntCast(Value* v);
 
 Value* InttoDoubleCast(Value* v);
 
+Value* exactInttoDoubleCast(Value* v);
+
+Value* exactIntOf(Value* v);
+
+Value* coerceLiteral(Value* v, Type* ty);
+
+Value* emitPow(Value* baseV, Value* exponentV);
+
+FastMathFlags getRapideMathFlags();
+
 Value* getConstantInt(int value);
 
+AllocaInst* createEntryBlockAlloca(Type* ty, Value* arraySize = nullptr);
+
+Value* allocateMemory(Type* ty, Value* numElems = nullptr);
+
+bool returnsAggregate();
+
+void markArena();
+
+void releaseArena();
+
+void beginIteration(BasicBlock* headerBB);
+
+void emitNextIteration(BasicBlock* headerBB);
+
+void endIteration();
+
+void escapeIterations(Value* ptr);
+
+void emitCopyOutOfIteration(Value* dst);
+
+void recordView(Value* viewPtr);
+
+void emitDropViews(size_t firstView = 0);
+
 void emitMemcpy(Value* dst, Value* src, Value* numElemstoCopy);
 
 Value* getGEPAt(Value* alloc, Value* idxV, bool isDataPtr = false);
@@ -24,9 +58,34 @@ void copyEntty(Value* dst, Value* src);
 
 void fillUpListEntty(Value* listPtr, std::vector<Value*> members, std::vector<Value*> dataValues = {});
 
+void emitListReserve(Value* listPtr, Value* minCapacityV);
+
+void emitListMakeUnique(Value* listPtr);
+
+void emitListShare(Value* listPtr);
+
+void emitListAppend(Value* listPtr, Value* valueV);
+
+void emitListExtend(Value* listPtr, Value* srcListPtr);
+
+Value* createLiteralList(Constant* dataV);
+
+void annotateMemoryAccesses(Function* fn);
+
 Function* getRtModuleFn(std::string name);
 
-void emitRtCheck(std::string name, std::vector<Value*> Args);
+// the kinds of runtime checks. The runtime's _kronk_rt_trap reports an error for each of them.
+enum class RtCheck : uint32_t {
+	INDEX,
+	SLICE,
+	ZERO_DIVISION
+};
+
+BranchInst* emitRtCheck(RtCheck kind, Value* okV, Value* listSizeV = nullptr);
+
+Value* emitFixIdx(Value* idxV, Value* listSizeV);
+
+Value* emitListIdxCheck(Value* idxV, Value* listSizeV);
 
 Value* emitRtCompilerUtilCall(std::string name, std::vector<Value*> Args);
 
@@ -0,0 +1,38 @@
+#ifndef _KRONK_AOT_H
+#define _KRONK_AOT_H
+
+#include <llvm/Target/TargetMachine.h>
+
+#include "Attributes.h"
+
+
+// the different kinds of files the ahead of time compiler can produce.
+enum class EmitKind {
+	EXECUTABLE,
+	OBJECT,
+	ASSEMBLY,
+	LLVM_IR,
+	BITCODE
+};
+
+
+class Kronkaot {
+	std::unique_ptr<llvm::Module> MainModule;
+	std::unique_ptr<llvm::TargetMachine> TM;
+
+	void aotError(std::string errMsg);
+	void createTargetMachine();
+	void linkRuntime();
+	void emitMachineCode(const fs::path& outputFile, llvm::CodeGenFileType fileType);
+	void linkExecutable(const fs::path& objectFile, const fs::path& outputFile);
+
+public:
+	static std::optional<EmitKind> parseEmitKind(const std::string& kind);
+
+	void compile(const fs::path& outputFile, EmitKind kind);
+
+	Kronkaot(std::unique_ptr<llvm::Module> MainModule) : MainModule(std::move(MainModule)) {}
+};
+
+
+#endif
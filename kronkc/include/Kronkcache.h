@@ -0,0 +1,58 @@
+#ifndef _KRONK_CACHE_H
+#define _KRONK_CACHE_H
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+
+#include <mutex>
+#include <optional>
+
+#include "Attributes.h"
+
+
+// On disk cache (under ~/.cache/kronk) for the optimized program module and the objects the jit
+// compiles from it. Entries are keyed by a hash of the ir, the target and the compiler version, so an
+// unchanged script skips both the optimization pipeline and codegen. Once the entries take more than
+// MaxCacheSize, the least recently used ones are evicted. Removing the directory clears the cache.
+class Kronkcache : public llvm::ObjectCache {
+	static const uintmax_t MaxCacheSize = 256 << 20;
+
+	fs::path cacheDir;
+	// identifies the target triple, cpu, features and compiler version the entries are valid for
+	std::string targetId;
+
+	// the compile threads query the cache concurrently
+	std::mutex cacheMutex;
+	std::unordered_map<const llvm::Module*, std::string> objectKeys;
+
+	size_t objectHits = 0;
+	size_t objectMisses = 0;
+	size_t bytesSaved = 0;
+	bool moduleHit = false;
+
+	// size of the entries, computed on the first write. Other runs may add to it in the meantime, they
+	// are counted the next time a run writes an entry.
+	std::optional<uintmax_t> cacheSize;
+	size_t evictions = 0;
+
+	std::string hashModule(const llvm::Module& M);
+	std::string objectKey(const llvm::Module* M, bool forget);
+	void writeEntry(const fs::path& entry, llvm::StringRef data);
+	void touchEntry(const fs::path& entry);
+	void evictEntries();
+
+public:
+	Kronkcache(std::string&& targetId);
+
+	std::string moduleKey(const llvm::Module& M);
+	std::unique_ptr<llvm::Module> getOptimizedModule(const std::string& key);
+	void storeOptimizedModule(const std::string& key, const llvm::Module& M);
+	bool keyUnoptimizedPartition(const llvm::Module& M);
+
+	void notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef Obj) override;
+	std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* M) override;
+
+	void printStats();
+};
+
+
+#endif
@@ -1,17 +1,34 @@
 #ifndef _KRONK_JIT_H
 #define _KRONK_JIT_H
 
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/CodeGen.h>
+
 #include "Attributes.h"
+#include "Kronkcache.h"
 
 class Kronkjit {
 	std::unique_ptr<llvm::Module> MainModule;
+	std::unique_ptr<Kronkcache> Cache;
 
-	void jitError();
+	static void jitError(std::string errMsg);
+	void linkRuntime(llvm::Linker& linker);
 
 public:
 	void LinkAndOptimize();
 	int runOrcLazyJIT();
 
+	// hands the linked and optimized program over to the ahead of time compiler
+	std::unique_ptr<llvm::Module> takeMainModule() { return std::move(MainModule); }
+
+	void printCacheStats() { Cache->printStats(); }
+
+	static bool hasPipeline();
+	static llvm::CodeGenOpt::Level getCodeGenOptLevel();
+	static llvm::orc::JITTargetMachineBuilder getJITTargetMachineBuilder(const std::string& TT);
+	static void optimizeModule(llvm::Module& M, llvm::TargetMachine* TM);
+
 	Kronkjit() : MainModule(std::make_unique<llvm::Module>("", Attr::Context)) {}
 };
 
@@ -0,0 +1,57 @@
+#ifndef _KRONK_TIER_H
+#define _KRONK_TIER_H
+
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Attributes.h"
+
+
+// Tiered compilation (--tiered). The program first runs unoptimized and compiled with the fast instruction
+// selector, while each kronk function counts how often it is entered and how often its loops go around.
+// A background thread recompiles the functions whose count crosses a threshold with the optimization
+// pipeline. Calls between functions go through indirect stubs, so the optimized code takes over from the
+// next call on. main itself is never recompiled since it only runs once, so its hot loops stay slow
+// unless they call functions.
+class Kronktier {
+	// a kronk function of the program. The tier 0 code is named <name>.tier0 and the optimized code
+	// <name>.tier1, while <name> is the stub that calls whichever one is current.
+	struct TieredFunction {
+		std::string name;
+		int64_t* count = nullptr;  // entries and loop iterations so far, only read atomically
+		bool isOptimized = false;
+	};
+
+	llvm::orc::LLLazyJIT& J;
+	std::unique_ptr<llvm::orc::IndirectStubsManager> Stubs;
+	std::vector<TieredFunction> functions;
+
+	// the program without the counters, as bitcode since the background thread parses it in its own
+	// context
+	std::string programBitcode;
+	std::string targetTriple;
+
+	std::thread worker;
+	std::atomic<bool> isStopping{ false };
+
+	void countEntriesAndLoops(llvm::Function& fn, llvm::GlobalVariable* count);
+	void optimizeFunction(const llvm::Module& program, const std::string& name, llvm::TargetMachine& TM);
+	void run();
+
+public:
+	Kronktier(llvm::orc::LLLazyJIT& J) : J(J) {}
+
+	// instruments M, which must not be added to the jit yet
+	void prepareModule(llvm::Module& M);
+
+	// once M is added, points the stubs to the tier 0 code and starts the background thread. Must be
+	// called before anything in the jit is looked up.
+	void start();
+	void stop();
+};
+
+
+#endif
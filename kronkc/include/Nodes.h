@@ -243,7 +243,7 @@ public:
 	    : entty(std::move(entty)), fieldId(std::move(fieldId)) {}
 
 	std::unique_ptr<Node> clone() override {
-		std::make_unique<EntityOperation>(entty->clone(), std::string(fieldId));
+		return std::make_unique<EntityOperation>(entty->clone(), std::string(fieldId));
 	}
 
 	bool injectCtx(bool ctx) override;
@@ -284,6 +284,33 @@ public:
 };
 
 
+// a < b <= c ... Each operand is evaluated once, and the comparisons stop at the first one that fails
+class ChainedComparison : public Node {
+public:
+	std::vector<std::string> Ops;
+	std::vector<std::unique_ptr<Node>> operands;
+
+	ChainedComparison(std::string&& Op, std::unique_ptr<Node>&& lhs, std::unique_ptr<Node>&& rhs) {
+		Ops.push_back(std::move(Op));
+		operands.push_back(std::move(lhs));
+		operands.push_back(std::move(rhs));
+	}
+
+	std::unique_ptr<Node> clone() override {
+		auto chain = std::make_unique<ChainedComparison>(std::string(Ops[0]), operands[0]->clone(),
+		                                                 operands[1]->clone());
+		for (size_t i = 1; i < Ops.size(); i++) {
+			chain->Ops.push_back(Ops[i]);
+			chain->operands.push_back(operands[i + 1]->clone());
+		}
+
+		return chain;
+	}
+
+	Value* codegen() override;
+};
+
+
 class Assignment : public Node {
 public:
 	std::unique_ptr<Node> lhs;
@@ -357,9 +384,11 @@ class FunctionDefn : public Node {
 public:
 	std::unique_ptr<Prototype> prototype;
 	std::unique_ptr<CompoundStmt> Body;
+	std::unordered_set<std::string> annotations;
 
-	FunctionDefn(std::unique_ptr<Prototype>&& prototype, std::unique_ptr<CompoundStmt>&& Body)
-	    : prototype(std::move(prototype)), Body(std::move(Body)) {}
+	FunctionDefn(std::unique_ptr<Prototype>&& prototype, std::unique_ptr<CompoundStmt>&& Body,
+	             std::unordered_set<std::string>&& annotations = {})
+	    : prototype(std::move(prototype)), Body(std::move(Body)), annotations(std::move(annotations)) {}
 	Value* codegen() override;
 };
 
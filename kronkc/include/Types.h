@@ -14,12 +14,17 @@ bool isEqual(Type* left, Type* right);
 bool isReel(Type* ty);
 bool isReel(Value* v);
 
+bool isEntier(Type* ty);
+bool isEntier(Value* v);
+
 StructType* isEnttyPtr(Type* type);
 StructType* isEnttyPtr(Value* v);
 
 bool isListePtr(Value* v);
 bool isStringPtr(Value* v);
 
+StructType* getListeType(Type* dataPtrTy);
+
 std::string typestr(Value* v);
 
 }  // namespace types
@@ -0,0 +1,266 @@
+#include "Analysis.h"
+
+#include <cmath>
+#include <optional>
+
+#include "IRGenAide.h"
+
+
+namespace analysis {
+
+
+// an assignment to an integral variable moves it by at most MaxStep, so every integral variable grows at
+// most linearly with the number of assignments the program executes. It would take more than 2^40 of
+// them before a value leaves the range where reels hold integers exactly (2^53), and until then i64
+// arithmetic gives the same results as the double arithmetic it replaces.
+static const double MaxStep = 1 << 10;
+
+// integral variables must also start in range
+static const double MaxLiteral = 1 << 30;
+
+
+// the variables a function (or the main program) writes to, along with what it writes to them
+struct Writes {
+	std::unordered_set<std::string> initialized;  // soit x = ...
+	std::unordered_set<std::string> excluded;     // soit x: type, and the function parameters
+	std::vector<std::pair<std::string, Node*>> assignments;
+};
+
+
+// returns the value of expr if it is an integral literal no larger than bound, or the negation of one
+static std::optional<int64_t> integralLiteral(Node* expr, double bound) {
+	double sign = 1;
+	if (auto unary = dynamic_cast<UnaryExpr*>(expr); unary and (unary->Op == "-")) {
+		sign = -1;
+		expr = unary->rhs.get();
+	}
+
+	auto literal = dynamic_cast<NumericLiteral*>(expr);
+	if ((not literal) or (std::trunc(literal->value) != literal->value) or
+	    (std::abs(literal->value) > bound)) {
+		return std::nullopt;
+	}
+
+	// -0 is a reel that no integer can stand for
+	auto value = sign * literal->value;
+	if ((value == 0) and std::signbit(value)) {
+		return std::nullopt;
+	}
+
+	return static_cast<int64_t>(value);
+}
+
+
+static bool isVar(Node* expr, const std::unordered_set<std::string>& vars) {
+	auto id = dynamic_cast<Identifier*>(expr);
+	return id and vars.count(id->name);
+}
+
+
+// what may be stored in an integral variable: x = k, x = y, x = y + k, x = y - k or x = k + y
+static bool isIntegralUpdate(Node* rhs, const std::unordered_set<std::string>& vars) {
+	if (integralLiteral(rhs, MaxLiteral) or isVar(rhs, vars)) {
+		return true;
+	}
+
+	auto binary = dynamic_cast<BinaryExpr*>(rhs);
+	if ((not binary) or ((binary->Op != "+") and (binary->Op != "-"))) {
+		return false;
+	}
+
+	if (isVar(binary->lhs.get(), vars) and integralLiteral(binary->rhs.get(), MaxStep)) {
+		return true;
+	}
+
+	return (binary->Op == "+") and integralLiteral(binary->lhs.get(), MaxStep) and
+	       isVar(binary->rhs.get(), vars);
+}
+
+
+// what may be evaluated as an i64 where only its integer value matters (comparisons, indices)
+static bool isIntegral(Node* expr, const std::unordered_set<std::string>& vars) {
+	if (integralLiteral(expr, MaxLiteral) or isVar(expr, vars)) {
+		return true;
+	}
+
+	if (auto unary = dynamic_cast<UnaryExpr*>(expr)) {
+		return (unary->Op == "-") and isIntegral(unary->rhs.get(), vars);
+	}
+
+	if (auto binary = dynamic_cast<BinaryExpr*>(expr)) {
+		if ((binary->Op == "+") or (binary->Op == "-")) {
+			return isIntegral(binary->lhs.get(), vars) and isIntegral(binary->rhs.get(), vars);
+		}
+
+		if (binary->Op == "mod") {
+			auto divisor = integralLiteral(binary->rhs.get(), MaxLiteral);
+			return isIntegral(binary->lhs.get(), vars) and divisor and (*divisor != 0);
+		}
+	}
+
+	return false;
+}
+
+
+static void collectWrites(Node* node, Writes& writes) {
+	if (not node) return;
+
+	if (auto stmt = dynamic_cast<CompoundStmt*>(node)) {
+		for (auto& s : stmt->block_stmt) collectWrites(s.get(), writes);
+	}
+
+	else if (auto declr = dynamic_cast<Declr*>(node)) {
+		writes.excluded.insert(declr->name);
+	}
+
+	else if (auto initDeclr = dynamic_cast<InitDeclr*>(node)) {
+		writes.initialized.insert(initDeclr->name);
+		writes.assignments.push_back({ initDeclr->name, initDeclr->rhs.get() });
+		collectWrites(initDeclr->rhs.get(), writes);
+	}
+
+	else if (auto binary = dynamic_cast<BinaryExpr*>(node)) {
+		if (auto id = dynamic_cast<Identifier*>(binary->lhs.get()); id and (binary->Op == "=")) {
+			writes.assignments.push_back({ id->name, binary->rhs.get() });
+		}
+
+		collectWrites(binary->lhs.get(), writes);
+		collectWrites(binary->rhs.get(), writes);
+	}
+
+	else if (auto chain = dynamic_cast<ChainedComparison*>(node)) {
+		for (auto& operand : chain->operands) collectWrites(operand.get(), writes);
+	}
+
+	else if (auto assn = dynamic_cast<Assignment*>(node)) {
+		if (auto id = dynamic_cast<Identifier*>(assn->lhs.get())) {
+			writes.assignments.push_back({ id->name, assn->rhs.get() });
+		}
+
+		collectWrites(assn->lhs.get(), writes);
+		collectWrites(assn->rhs.get(), writes);
+	}
+
+	else if (auto unary = dynamic_cast<UnaryExpr*>(node)) {
+		collectWrites(unary->rhs.get(), writes);
+	}
+
+	else if (auto ifStmt = dynamic_cast<IfStmt*>(node)) {
+		collectWrites(ifStmt->Cond.get(), writes);
+		collectWrites(ifStmt->ThenBody.get(), writes);
+		collectWrites(ifStmt->ElseBody.get(), writes);
+	}
+
+	else if (auto whileStmt = dynamic_cast<WhileStmt*>(node)) {
+		collectWrites(whileStmt->Cond.get(), writes);
+		collectWrites(whileStmt->Body.get(), writes);
+	}
+
+	else if (auto returnStmt = dynamic_cast<ReturnStmt*>(node)) {
+		collectWrites(returnStmt->returnExpr.get(), writes);
+	}
+
+	else if (auto call = dynamic_cast<FunctionCallExpr*>(node)) {
+		for (auto& arg : call->Args) collectWrites(arg.get(), writes);
+	}
+
+	else if (auto lst = dynamic_cast<AnonymousList*>(node)) {
+		for (auto& elem : lst->initList) collectWrites(elem.get(), writes);
+	}
+
+	else if (auto idxRef = dynamic_cast<ListIdxRef*>(node)) {
+		collectWrites(idxRef->list.get(), writes);
+		collectWrites(idxRef->idx.get(), writes);
+	}
+
+	else if (auto slice = dynamic_cast<ListSlice*>(node)) {
+		collectWrites(slice->list.get(), writes);
+		collectWrites(slice->start.get(), writes);
+		collectWrites(slice->end.get(), writes);
+	}
+
+	else if (auto entty = dynamic_cast<AnonymousEntity*>(node)) {
+		for (auto& [fieldIndex, fieldExpr] : entty->enttyCons) collectWrites(fieldExpr.get(), writes);
+	}
+
+	else if (auto enttyOp = dynamic_cast<EntityOperation*>(node)) {
+		collectWrites(enttyOp->entty.get(), writes);
+	}
+}
+
+
+/// Finds the reel variables of a function body (or of the main program) that only ever hold integers,
+/// so they can be kept in i64 registers. A variable qualifies if it is initialized by `soit` and every
+/// value stored in it is an integral literal, or another such variable moved by a small integral step.
+/// Loop counters and indices (i = 0, i = i + 1) are the typical case.
+std::unordered_set<std::string> findIntegralVars(const std::vector<std::unique_ptr<Node>>& stmts,
+                                                 const std::vector<std::string>& params) {
+	Writes writes;
+	writes.excluded.insert(params.begin(), params.end());
+
+	for (auto& stmt : stmts) collectWrites(stmt.get(), writes);
+
+	std::unordered_set<std::string> vars;
+	for (auto& name : writes.initialized) {
+		if (not writes.excluded.count(name)) vars.insert(name);
+	}
+
+	// a variable that is disqualified may disqualify the variables it is stored in, so repeat until
+	// nothing changes
+	bool changed = true;
+	while (changed) {
+		changed = false;
+
+		for (auto& [name, rhs] : writes.assignments) {
+			if (vars.count(name) and (not isIntegralUpdate(rhs, vars))) {
+				vars.erase(name);
+				changed = true;
+			}
+		}
+	}
+
+	return vars;
+}
+
+
+bool isIntegralExpr(Node* expr) { return isIntegral(expr, Attr::ScopeStack.back()->IntegralVars); }
+
+
+// emits expr, which must satisfy isIntegralExpr, as an i64.
+Value* emitIntegralExpr(Node* expr) {
+	if (auto value = integralLiteral(expr, MaxLiteral)) {
+		return ConstantInt::get(Attr::Builder.getInt64Ty(), *value, true);
+	}
+
+	if (auto id = dynamic_cast<Identifier*>(expr)) {
+		auto& symbolTable = Attr::ScopeStack.back()->SymbolTable;
+		if (symbolTable.count(id->name) == 0) {
+			irGenAide::LogCodeGenError("Unknown Identifier << " + id->name + " >>");
+		}
+
+		return Attr::Builder.CreateLoad(symbolTable[id->name]);
+	}
+
+	if (auto unary = dynamic_cast<UnaryExpr*>(expr)) {
+		return Attr::Builder.CreateNeg(emitIntegralExpr(unary->rhs.get()));
+	}
+
+	auto binary = static_cast<BinaryExpr*>(expr);
+	auto lhsV = emitIntegralExpr(binary->lhs.get());
+	auto rhsV = emitIntegralExpr(binary->rhs.get());
+
+	// the values stay far from overflowing, which tells llvm that loop counters don't wrap around
+	if (binary->Op == "+") {
+		return Attr::Builder.CreateNSWAdd(lhsV, rhsV);
+	}
+
+	if (binary->Op == "-") {
+		return Attr::Builder.CreateNSWSub(lhsV, rhsV);
+	}
+
+	// the divisor is a non zero literal
+	return Attr::Builder.CreateSRem(lhsV, rhsV);
+}
+
+
+}  // namespace analysis
@@ -0,0 +1,50 @@
+#include "Analysis.h"
+
+
+namespace analysis {
+
+
+// the call made by a return statement of the function fnName to itself, if there is one
+FunctionCallExpr* getSelfTailCall(Node* stmt, const std::string& fnName) {
+	auto returnStmt = dynamic_cast<ReturnStmt*>(stmt);
+	if (not returnStmt) return nullptr;
+
+	auto call = dynamic_cast<FunctionCallExpr*>(returnStmt->returnExpr.get());
+	return (call and (call->Callee == fnName)) ? call : nullptr;
+}
+
+
+static bool containsSelfTailCall(Node* stmt, const std::string& fnName) {
+	if (not stmt) return false;
+
+	if (getSelfTailCall(stmt, fnName)) {
+		return true;
+	}
+
+	if (auto compound = dynamic_cast<CompoundStmt*>(stmt)) {
+		return std::any_of(compound->block_stmt.begin(), compound->block_stmt.end(),
+		                   [&fnName](auto& s) { return containsSelfTailCall(s.get(), fnName); });
+	}
+
+	if (auto ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+		return containsSelfTailCall(ifStmt->ThenBody.get(), fnName) or
+		       containsSelfTailCall(ifStmt->ElseBody.get(), fnName);
+	}
+
+	if (auto whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+		return containsSelfTailCall(whileStmt->Body.get(), fnName);
+	}
+
+	return false;
+}
+
+
+/// Whether the body of the function fnName has a statement `ret fnName(...)`. Such calls are turned into
+/// jumps back to the start of the function, so the recursion runs in constant stack space.
+bool hasSelfTailCall(const std::vector<std::unique_ptr<Node>>& stmts, const std::string& fnName) {
+	return std::any_of(stmts.begin(), stmts.end(),
+	                   [&fnName](auto& stmt) { return containsSelfTailCall(stmt.get(), fnName); });
+}
+
+
+}  // namespace analysis
@@ -6,7 +6,24 @@
 namespace Attr {
 
 bool PRINT_DEBUG_INFO;
-bool INCLUDE_MODE;  // compilation mode for the kronk file
+bool INCLUDE_MODE;    // compilation mode for the kronk file
+bool CACHE_STATS;     // report compile cache statistics when the program ends
+bool INLINE_RUNTIME;  // link the runtime into the program before optimizing it
+bool SANS_VERIFICATIONS;  // leave out the index, slice and zero division checks
+std::string VECLIB;       // vector math library for sin, cos... in vectorized loops. Empty for none
+bool RAPIDE_MATH;         // let llvm reorder reel arithmetic in the whole program, see @rapide
+bool SANS_NAN_INF;        // the rapide math code may also assume reels are never nan or infinite
+// functions that stay visible outside the program, besides main
+std::unordered_set<std::string> EXPORTS;
+std::string OPT_LEVEL;  // O0, O1, O2, O3 or Os
+std::string PASSES;     // textual pass pipeline that replaces the one of OPT_LEVEL. Empty for none
+bool TIME_PASSES;       // report the time taken by each optimization pass
+bool TIERED;            // optimize only the hot functions, in the background. See Kronktier
+bool LAZY_OPTIMIZE;     // optimize each partition of the program when the jit first materializes it
+unsigned JIT_THREADS;   // threads the jit compiles partitions on
+std::string JIT_PARTITION;  // what the jit compiles at once: a function, its scc or the whole module
+bool SPECULATE;             // compile the functions a partition calls before they are called
+bool ALLOC_STATS;           // report how much memory the program allocated when it ends
 
 llvm::LLVMContext Context;
 IRBuilder<> Builder(Context);
@@ -24,6 +41,9 @@ size_t CurrentLexerLine;
 // stack for storing scopes
 std::vector<std::unique_ptr<Scope>> ScopeStack;
 
+// index of ThisModule's file in SourceFiles
+uint32_t SourceFileId;
+
 // dependency moduleIds for ThisModule
 std::vector<std::string> Dependencies;
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +61,9 @@ std::unordered_map<std::string, std::string> DuplicateModuleMap;
 // maps a filename ( the absolute file path ) to the moduleId used to compile it (this moduleId is
 // referred) to as the primordial moduleId
 std::map<fs::path, std::string> FileToModuleIdMap;
+// names of the compiled files, in the order they were compiled. Runtime checks refer to a file by its
+// index in here, and the runtime gets the names from the _kronk_source_files table.
+std::vector<std::string> SourceFiles;
 
 
 SMDiagnostic error;
@@ -51,7 +74,30 @@ const std::unordered_set<std::string> KronkrtModules = { "io", "math" };
 // special functions in the kronkrt that can be called directly without including their rtModule;
 const std::unordered_map<std::string, std::string> DirectFunctions = { { "afficher", "io" } };
 
-const std::unordered_set<std::string> BuiltinTypes = { "bool", "reel", "str" };
+// builtin functions on listes. They work on listes of any element type, so kronkc emits them inline.
+const std::unordered_set<std::string> ListFunctions = { "ajouter", "reserver" };
+
+// conversions between the number types. They share their names with the types they convert to.
+const std::unordered_set<std::string> ConversionFunctions = { "entier", "reel" };
+
+// annotations of function definitions, ex. fn somme(lst: liste(reel)) reel @rapide { ... }
+// @rapide lets llvm reorder the reel arithmetic of the function, like --rapide-math does for the program
+const std::unordered_set<std::string> FunctionAnnotations = { "rapide" };
+
+// runtime math functions that are emitted as llvm intrinsics instead, so llvm can fold and vectorize
+// them. _kmath_puiss goes through irGenAide::emitPow.
+const std::unordered_map<std::string, Intrinsic::ID> MathIntrinsics = {
+	{ "_kmath_sin", Intrinsic::sin }, { "_kmath_cos", Intrinsic::cos }, { "_kmath_exp", Intrinsic::exp }
+};
+
+// the vector math libraries supported by --veclib, along with the library the program is then linked to
+const std::unordered_map<std::string, std::string> VecLibs = { { "SVML", "svml" },
+	                                                             { "MASSV", "massv" } };
+
+// the partitioning policies of --jit-partition
+const std::unordered_set<std::string> JitPartitions = { "function", "scc", "module" };
+
+const std::unordered_set<std::string> BuiltinTypes = { "bool", "reel", "entier", "str" };
 
 const std::unordered_map<std::string, uint8_t> KronkOperators = {
 	{ "non", 100 }, { "~", 100 },
@@ -89,6 +135,9 @@ const std::unordered_set<std::string> RightAssociativeOps = { "**", "=" };
 // the lexer moves to the next statement before ir is generated for the current statement's ast
 size_t IRGenLineOffset;
 
+// set by the driver while it holds back statements of the main program, see CompileDriver::driver
+std::function<void()> BeforeCompileError;
+
 
 }  // end of namespace Attr
 
@@ -97,3 +146,13 @@ size_t IRGenLineOffset;
 void LogProgress(std::string str) {
 	if (Attr::PRINT_DEBUG_INFO) std::cout << "[ Debug Info ]: " << str << std::endl;
 }
+
+
+// Called before an error is reported. Generates the statements the driver held back, so that their
+// errors are reported first if they come earlier in the file.
+void LogEarlierErrors() {
+	auto beforeCompileError = std::move(Attr::BeforeCompileError);
+	Attr::BeforeCompileError = nullptr;
+
+	if (beforeCompileError) beforeCompileError();
+}
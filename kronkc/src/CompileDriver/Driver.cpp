@@ -1,5 +1,7 @@
 #include "Driver.h"
 
+#include "Analysis.h"
+#include "IRGenAide.h"
 #include "Names.h"
 #include "Parser.h"
 
@@ -57,11 +59,18 @@ std::string CompileDriver::compileInputFile(std::string&& moduleId) {
 	Attr::ThisModule = std::make_unique<llvm::Module>(moduleId, Attr::Context);
 	Attr::FileToModuleIdMap[inputFile] = moduleId;
 
+	Attr::SourceFileId = Attr::SourceFiles.size();
+	Attr::SourceFiles.push_back(inputFile.filename().string());
+
 	InitializeNativeTarget();
 	InitializeNativeTargetAsmPrinter();
 
 	Attr::ThisModule->setTargetTriple(llvm::sys::getDefaultTargetTriple());
 
+	if (Attr::RAPIDE_MATH) {
+		Attr::Builder.setFastMathFlags(irGenAide::getRapideMathFlags());
+	}
+
 	// then our mainfunction
 	auto mainFnTy = llvm::FunctionType::get(Attr::Builder.getInt32Ty(), false);
 	auto mainFn =
@@ -74,15 +83,20 @@ std::string CompileDriver::compileInputFile(std::string&& moduleId) {
 
 	driver();
 
-	Attr::ScopeStack.pop_back();  // pop the last scope
-
 	// The program termination block
 	auto endProgramblock = BasicBlock::Create(Attr::Context, "ProgramExit", mainFn);
 	Attr::Builder.CreateBr(endProgramblock);
 	Attr::Builder.SetInsertPoint(endProgramblock);
+
+	irGenAide::emitDropViews();
+	irGenAide::releaseArena();
+	if (Attr::ALLOC_STATS) irGenAide::emitRtCompilerUtilCall("_kronk_print_alloc_stats", {});
+	Attr::ScopeStack.pop_back();  // pop the last scope
+
 	Attr::Builder.CreateRet(
 	    Attr::Builder.getInt32(0));  // On termination our program always returns zero
 
+	irGenAide::annotateMemoryAccesses(mainFn);
 	llvm::verifyFunction(*mainFn);
 
 	if (Attr::INCLUDE_MODE) {
@@ -116,19 +130,61 @@ void CompileDriver::driver() {
 	auto parser = Parser::CreateParser(std::move(inputFile));
 	parser->moveToNextToken();  // read the first token from the input file
 
-	while (true) {
-		if (parser->currToken() == Token::END_OF_FILE) {
-			LogProgress("Compile Sucess!!");
-			return;
+	// ir for the statements of the main program is only generated once the whole file is parsed, so
+	// that the analysis sees every use of a variable before we choose how to store it. Function
+	// definitions are held back along with them, so ir is still generated in the order of the file.
+	// Entity definitions and includes are generated right away, since the parser needs the types and the
+	// modules they bring in.
+	std::vector<std::unique_ptr<Node>> heldStmts;
+	// the lexer's position after each of heldStmts was parsed. used to report errors at the right line
+	std::vector<std::pair<size_t, size_t>> heldStmtLines;
+
+	auto codegenHeldStmts = [&] {
+		Attr::ScopeStack.back()->IntegralVars = analysis::findIntegralVars(heldStmts);
+
+		for (size_t i = 0; i < heldStmts.size(); ++i) {
+			std::tie(Attr::CurrentLexerLine, Attr::IRGenLineOffset) = heldStmtLines[i];
+			heldStmts[i]->codegen();
 		}
 
+		heldStmts.clear();
+		heldStmtLines.clear();
+	};
+
+	// a parse error, or an error in an entity definition or include, is only reported once the held
+	// statements before it are generated, so errors still come out in the order of the file. Errors in
+	// an included file are reported by the driver of that file, while this module is suspended.
+	auto prevBeforeCompileError = std::move(Attr::BeforeCompileError);
+	auto thisModule = Attr::ThisModule.get();
+
+	Attr::BeforeCompileError = [&] {
+		if (Attr::ThisModule.get() != thisModule) return;
+
+		auto errorLine = std::make_pair(Attr::CurrentLexerLine, Attr::IRGenLineOffset);
+		codegenHeldStmts();
+		std::tie(Attr::CurrentLexerLine, Attr::IRGenLineOffset) = errorLine;
+	};
+
+	while (parser->currToken() != Token::END_OF_FILE) {
 		auto stmt_ast = parser->ParseStmt(true);
-		if (stmt_ast) {
+
+		if (dynamic_cast<EntityDefn*>(stmt_ast.get()) or dynamic_cast<IncludeStmt*>(stmt_ast.get())) {
 			stmt_ast->codegen();
 		}
 
+		else if (stmt_ast) {
+			heldStmts.push_back(std::move(stmt_ast));
+			heldStmtLines.push_back({ Attr::CurrentLexerLine, Attr::IRGenLineOffset });
+		}
+
 		Attr::IRGenLineOffset = 0;
 	}
+
+	Attr::BeforeCompileError = std::move(prevBeforeCompileError);
+	codegenHeldStmts();
+
+	Attr::IRGenLineOffset = 0;
+	LogProgress("Compile Sucess!!");
 }
 
 
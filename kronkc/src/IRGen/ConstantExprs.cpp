@@ -1,3 +1,4 @@
+#include "Analysis.h"
 #include "IRGenAide.h"
 #include "Nodes.h"
 
@@ -28,6 +29,12 @@ Value* Identifier::codegen() {
 		// from the symbol table
 		return ptr;
 	}
+
+	if (ctx and Attr::ScopeStack.back()->IntegralVars.count(name)) {
+		// the variable is kept as an i64, but it is still a reel to the rest of the program
+		return irGenAide::exactInttoDoubleCast(Attr::Builder.CreateLoad(ptr));
+	}
+
 	return (ctx) ? Attr::Builder.CreateLoad(ptr) : ptr;
 }
 
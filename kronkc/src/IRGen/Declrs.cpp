@@ -1,30 +1,31 @@
+#include "Analysis.h"
 #include "IRGenAide.h"
 #include "Nodes.h"
 
 
 Value* Declr::codegen() {
 	auto typeTy = type->typegen();
-	AllocaInst* alloc;
+	Value* alloc;
 
 	if (typeTy->isStructTy()) {
 		auto enttyTy = llvm::cast<StructType>(typeTy);
-		alloc = Attr::Builder.CreateAlloca(enttyTy);
+		alloc = irGenAide::allocateMemory(enttyTy);
 
 		if (enttyTy->isLiteral()) {
 			// We're declaring a liste with zero elements
 
 			auto listSizeV = irGenAide::getConstantInt(0);
-			auto dataPtr = Attr::Builder.CreateAlloca(
+			auto dataPtr = irGenAide::allocateMemory(
 			    enttyTy->getTypeAtIndex(1)->getPointerElementType(), listSizeV);
-			irGenAide::fillUpListEntty(alloc, { listSizeV, dataPtr });
+			irGenAide::fillUpListEntty(alloc, { listSizeV, dataPtr, listSizeV });
 		}
 
 		Attr::ScopeStack.back()->HeapAllocas.push_back(alloc);
 	}
 
 	else {
-		// We're declaring either an i1 or double on the stack
-		alloc = Attr::Builder.CreateAlloca(typeTy);
+		// We're declaring either an i1, i64 or double on the stack
+		alloc = irGenAide::createEntryBlockAlloca(typeTy);
 	}
 
 	Attr::ScopeStack.back()->SymbolTable[name] = alloc;
@@ -33,6 +34,15 @@ Value* Declr::codegen() {
 
 
 Value* InitDeclr::codegen() {
+	if (Attr::ScopeStack.back()->IntegralVars.count(name)) {
+		auto rvalue = analysis::emitIntegralExpr(rhs.get());
+		auto alloc = irGenAide::createEntryBlockAlloca(rvalue->getType());
+		Attr::ScopeStack.back()->SymbolTable[name] = alloc;
+		Attr::Builder.CreateStore(rvalue, alloc);
+
+		return nullptr;
+	}
+
 	auto rvalue = rhs->codegen();
 
 	// An Expression node on emitting ir always returns one of two types: a value holding an i1, i64, or
@@ -53,7 +63,7 @@ Value* InitDeclr::codegen() {
 		}
 
 		else {
-			AllocaInst* alloc = Attr::Builder.CreateAlloca(rvalueTy);
+			auto alloc = irGenAide::allocateMemory(rvalueTy);
 			irGenAide::copyEntty(alloc, rvalue);
 
 			Attr::ScopeStack.back()->SymbolTable[name] = alloc;
@@ -66,7 +76,7 @@ Value* InitDeclr::codegen() {
 		// returns
 		/// a primitve type
 
-		AllocaInst* alloc = Attr::Builder.CreateAlloca(rvalue->getType());
+		auto alloc = irGenAide::createEntryBlockAlloca(rvalue->getType());
 		Attr::ScopeStack.back()->SymbolTable[name] = alloc;
 		// Now store rvalue in lvalue
 		Attr::Builder.CreateStore(rvalue, alloc);
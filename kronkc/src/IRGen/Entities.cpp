@@ -30,7 +30,7 @@ Value* EntityDefn::codegen() {
 
 Value* AnonymousEntity::codegen() {
 	// first allocate space for the entity. The parser already made sure the entyTypeId exists.
-	AllocaInst* enttyPtr = Attr::Builder.CreateAlloca(names::EntityType(enttyTypeId).value());
+	auto enttyPtr = irGenAide::allocateMemory(names::EntityType(enttyTypeId).value());
 	Attr::ScopeStack.back()->HeapAllocas.push_back(enttyPtr);
 
 	// then init entity's fields.
@@ -41,10 +41,10 @@ Value* AnonymousEntity::codegen() {
 		// storing in the field's address
 		if (enttyCons.find(fieldIndex) != enttyCons.end()) {
 			auto& fieldExpr = enttyCons.at(fieldIndex);
-			auto fieldV = fieldExpr->codegen();
-			auto fieldExprTy = fieldV->getType();
 			auto fieldAddr = irGenAide::getGEPAt(enttyPtr, irGenAide::getConstantInt(fieldIndex));
 			auto fieldAddrTy = fieldAddr->getType()->getPointerElementType();
+			auto fieldV = irGenAide::coerceLiteral(fieldExpr->codegen(), fieldAddrTy);
+			auto fieldExprTy = fieldV->getType();
 
 			if (not types::isEqual(fieldAddrTy, fieldExprTy)) {
 				auto [kmodule, symbol] = names::demangleNameForErrMsg(enttyTypeId);
@@ -106,7 +106,7 @@ Value* EntityOperation::codegen() {
 		if (types::isListePtr(enttyPtr)) {
 			// since we're loading the << size >> field as this is a liste, we cast it to double so it
 			// becomes compatible with Values of type reel
-			return Attr::Builder.CreateCast(Instruction::SIToFP, value, Attr::Builder.getDoubleTy());
+			return irGenAide::exactInttoDoubleCast(value);
 		}
 
 		return value;
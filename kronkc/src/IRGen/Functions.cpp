@@ -1,3 +1,4 @@
+#include "Analysis.h"
 #include "IRGenAide.h"
 #include "Names.h"
 #include "Nodes.h"
@@ -18,6 +19,10 @@ void editArgsForPrint(std::vector<Value*>& values) {
 			strFormat += 'r';
 		}
 
+		else if (types::isEntier(v)) {
+			strFormat += 'e';
+		}
+
 		else if (types::isStringPtr(v)) {
 			strFormat += 's';
 			auto strSize =
@@ -42,6 +47,76 @@ void editArgsForPrint(std::vector<Value*>& values) {
 }
 
 
+Value* emitListFunctionCall(const std::string& name, std::vector<std::unique_ptr<Node>>& Args) {
+	// ajouter(lst, x) appends x, or the elements of x if it is a liste of the same type, to lst.
+	// reserver(lst, n) makes room for n elements in lst, so that appending them doesn't move it.
+
+	if (Args.size() != 2) {
+		irGenAide::LogCodeGenError("<< " + name + " >> takes 2 arguments, but " +
+		                           std::to_string(Args.size()) + " were given");
+	}
+
+	auto lstPtr = Args[0]->codegen();
+	if (not types::isListePtr(lstPtr)) {
+		irGenAide::LogCodeGenError("The first argument of << " + name + " >> must be a liste");
+	}
+
+	auto argV = Args[1]->codegen();
+
+	if (name == "reserver") {
+		if (types::isReel(argV)) {
+			argV = irGenAide::DoubletoIntCast(argV);
+		}
+
+		else if (not types::isEntier(argV)) {
+			irGenAide::LogCodeGenError("The second argument of << reserver >> must be a number");
+		}
+
+		irGenAide::emitListReserve(lstPtr, argV);
+		return lstPtr;
+	}
+
+	auto dataPtrTy = types::isEnttyPtr(lstPtr)->getElementType(1);
+	argV = irGenAide::coerceLiteral(argV, dataPtrTy->getPointerElementType());
+
+	if (types::isEqual(argV->getType(), dataPtrTy->getPointerElementType())) {
+		irGenAide::emitListAppend(lstPtr, argV);
+	}
+
+	else if (types::isEqual(argV->getType(), lstPtr->getType())) {
+		irGenAide::emitListExtend(lstPtr, argV);
+	}
+
+	else {
+		irGenAide::LogCodeGenError("Trying to add a value of type << " + types::typestr(argV) +
+		                           " >> to a << " + types::typestr(lstPtr) + " >>");
+	}
+
+	return lstPtr;
+}
+
+
+// entier(x) and reel(x) convert x to an entier (rounding towards zero) or to a reel.
+Value* emitConversionCall(const std::string& name, std::vector<std::unique_ptr<Node>>& Args) {
+	if (Args.size() != 1) {
+		irGenAide::LogCodeGenError("<< " + name + " >> takes exactly one argument");
+	}
+
+	auto argV = Args[0]->codegen();
+
+	if ((not types::isReel(argV)) and (not types::isEntier(argV))) {
+		irGenAide::LogCodeGenError("Cannot convert a value of type << " + types::typestr(argV) +
+		                           " >> to << " + name + " >>");
+	}
+
+	if (name == "entier") {
+		return types::isReel(argV) ? irGenAide::DoubletoIntCast(argV) : argV;
+	}
+
+	return types::isEntier(argV) ? irGenAide::InttoDoubleCast(argV) : argV;
+}
+
+
 void matchArgTys(Function* fn, std::vector<Value*>& values) {
 	auto fnTy = fn->getFunctionType();
 	// first match arg numbers
@@ -57,8 +132,8 @@ void matchArgTys(Function* fn, std::vector<Value*>& values) {
 
 	// then match arg types
 	for (int i = 0; i < values.size(); ++i) {
-		auto v = values[i];
 		auto paramTy = fnTy->getParamType(i);
+		auto v = values[i] = irGenAide::coerceLiteral(values[i], paramTy);
 
 		if (not types::isEqual(v->getType(), paramTy)) {
 			irGenAide::LogCodeGenError("Type mismatch for argument #" + std::to_string(i + 1) +
@@ -102,6 +177,16 @@ Value* Prototype::codegen() {
 	unsigned Idx = 0;
 	for (auto& Arg : fn->args()) Arg.setName(paramNames[Idx++]);
 
+	// a liste argument always points to a whole liste
+	for (auto& Arg : fn->args()) {
+		if (types::isListePtr(&Arg)) {
+			auto listSize = Attr::ThisModule->getDataLayout().getTypeAllocSize(
+			    Arg.getType()->getPointerElementType());
+			Arg.addAttr(Attribute::NonNull);
+			Arg.addAttr(Attribute::getWithDereferenceableBytes(Attr::Context, listSize.getFixedSize()));
+		}
+	}
+
 	return fn;
 }
 
@@ -115,6 +200,12 @@ Value* FunctionDefn::codegen() {
 
 	auto PreFuncBlock = Attr::Builder.GetInsertBlock();
 
+	// the reel arithmetic of @rapide functions may be reordered
+	IRBuilderBase::FastMathFlagGuard fmfGuard(Attr::Builder);
+	if (annotations.count("rapide")) {
+		Attr::Builder.setFastMathFlags(irGenAide::getRapideMathFlags());
+	}
+
 	Attr::ScopeStack.push_back(std::make_unique<Scope>());
 
 	auto fnEntryBB = BasicBlock::Create(Attr::Context, "FunctionEntry");
@@ -122,6 +213,8 @@ Value* FunctionDefn::codegen() {
 	Attr::ScopeStack.back()->fnExitBB = fnExitBB;
 
 	auto fn = llvm::cast<Function>(prototype->codegen());
+	Attr::ScopeStack.back()->IntegralVars =
+	    analysis::findIntegralVars(Body->block_stmt, prototype->paramNames);
 
 	fn->getBasicBlockList().push_back(fnEntryBB);
 	Attr::Builder.SetInsertPoint(fnEntryBB);
@@ -137,10 +230,26 @@ Value* FunctionDefn::codegen() {
 		Attr::Builder.CreateStore(static_cast<llvm::Value*>(&arg), alloca);
 		// we use the names set in the protottype declaration.
 		Attr::ScopeStack.back()->SymbolTable[std::string(arg.getName())] = alloca;
+		Attr::ScopeStack.back()->ParamAllocas.push_back(alloca);
+	}
+
+	if (analysis::hasSelfTailCall(Body->block_stmt, prototype->fnName)) {
+		// the body becomes a loop that self tail calls go around with new arguments. Like in any loop,
+		// the memory allocated in the body must be fresh on every iteration.
+		auto tailRecurseBB = BasicBlock::Create(Attr::Context, "TailRecurse", fn);
+		Attr::Builder.CreateBr(tailRecurseBB);
+		Attr::Builder.SetInsertPoint(tailRecurseBB);
+
+		Attr::ScopeStack.back()->tailRecurseBB = tailRecurseBB;
+		irGenAide::beginIteration(tailRecurseBB);
 	}
 
 	Body->codegen();
 
+	if (Attr::ScopeStack.back()->tailRecurseBB) {
+		irGenAide::endIteration();
+	}
+
 	if (not Attr::Builder.GetInsertBlock()->getTerminator()) {
 		// this takes care of functions with no return stmts.
 		Attr::Builder.CreateBr(fnExitBB);
@@ -149,8 +258,12 @@ Value* FunctionDefn::codegen() {
 	fn->getBasicBlockList().push_back(fnExitBB);
 	Attr::Builder.SetInsertPoint(fnExitBB);
 
+	irGenAide::emitDropViews();
+	irGenAide::releaseArena();
 	Attr::Builder.CreateRet(Attr::Builder.CreateLoad(Attr::ScopeStack.back()->returnValue));
 
+	irGenAide::annotateMemoryAccesses(fn);
+
 	// if(not llvm::verifyFunction(*fn))
 	//    irGenAide::LogCodeGenError("There's a problem with your function definition kronk can't figure
 	//    out");
@@ -162,6 +275,36 @@ Value* FunctionDefn::codegen() {
 }
 
 
+// `ret fn(args)` in fn itself. Stores the new arguments where the parameters live and jumps back to the
+// start of the body instead of calling, see FunctionDefn::codegen.
+static Value* emitSelfTailCall(Function* fn, FunctionCallExpr* call) {
+	std::vector<Value*> ArgsV;
+	for (auto& arg : call->Args) {
+		ArgsV.push_back(arg->codegen());
+	}
+
+	matchArgTys(fn, ArgsV);
+
+	// every argument is evaluated before any parameter is overwritten, since they may use the parameters
+	auto& paramAllocas = Attr::ScopeStack.back()->ParamAllocas;
+	for (size_t i = 0; i < ArgsV.size(); ++i) {
+		Attr::Builder.CreateStore(ArgsV[i], paramAllocas[i]);
+
+		// the parameters outlive the iteration, unless they are passed on as they are
+		auto loadV = dyn_cast<LoadInst>(ArgsV[i]);
+		auto isParam = [loadV](Value* paramAlloca) { return paramAlloca == loadV->getPointerOperand(); };
+
+		if (ArgsV[i]->getType()->isPointerTy() and
+		    ((not loadV) or std::none_of(paramAllocas.begin(), paramAllocas.end(), isParam))) {
+			irGenAide::escapeIterations(nullptr);
+		}
+	}
+
+	irGenAide::emitNextIteration(Attr::ScopeStack.back()->tailRecurseBB);
+	return nullptr;
+}
+
+
 Value* ReturnStmt::codegen() {
 	LogProgress("Generating Return Stmt");
 
@@ -171,11 +314,25 @@ Value* ReturnStmt::codegen() {
 		irGenAide::LogCodeGenError("return statements must only be in function definitions");
 	}
 
-	auto rvalue = returnExpr->codegen();
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	if (auto call = analysis::getSelfTailCall(this, currFunction->getName().str());
+	    call and Attr::ScopeStack.back()->tailRecurseBB) {
+		return emitSelfTailCall(currFunction, call);
+	}
+
 	auto lvalue = Attr::ScopeStack.back()->returnValue;
+	auto lvalueTy = lvalue->getType()->getPointerElementType();
 
+	auto rvalue = irGenAide::coerceLiteral(returnExpr->codegen(), lvalueTy);
 	auto rvalueTy = rvalue->getType();
-	auto lvalueTy = lvalue->getType()->getPointerElementType();
+
+	if (auto call = dyn_cast<CallInst>(rvalue)) {
+		// the callee can't be handed pointers into our frame, so it may reuse it
+		auto isPointer = [](Value* arg) { return arg->getType()->isPointerTy(); };
+		if (std::none_of(call->arg_begin(), call->arg_end(), isPointer)) {
+			call->setTailCall();
+		}
+	}
 
 	if (not types::isEqual(rvalueTy, lvalueTy)) {
 		irGenAide::LogCodeGenError("Return value type does not correspond to function return type");
@@ -193,6 +350,19 @@ Value* FunctionCallExpr::codegen() {
 
 	std::vector<Value*> ArgsV;  // holds codegen for each argument
 
+	// builtin liste functions, unless the module defines its own function with that name
+	if (auto [kmodule, symbol] = names::demangleName(Callee);
+	    (kmodule == Attr::ThisModule->getModuleIdentifier()) and Attr::ListFunctions.count(symbol) and
+	    (not Attr::ThisModule->getFunction(Callee))) {
+		return emitListFunctionCall(symbol, Args);
+	}
+
+	if (auto [kmodule, symbol] = names::demangleName(Callee);
+	    (kmodule == Attr::ThisModule->getModuleIdentifier()) and
+	    Attr::ConversionFunctions.count(symbol) and (not Attr::ThisModule->getFunction(Callee))) {
+		return emitConversionCall(symbol, Args);
+	}
+
 	auto fnExists = names::Function(Callee);
 
 	if (fnExists) {
@@ -212,6 +382,31 @@ Value* FunctionCallExpr::codegen() {
 
 		// match ArgsV against fn prototype
 		matchArgTys(fn, ArgsV);
+
+		if (fn->getName() == "_kmath_puiss") {
+			return irGenAide::emitPow(ArgsV[0], ArgsV[1]);
+		}
+
+		if (auto it = Attr::MathIntrinsics.find(fn->getName().str()); it != Attr::MathIntrinsics.end()) {
+			return Attr::Builder.CreateIntrinsic(it->second, { fn->getReturnType() }, ArgsV);
+		}
+
+		// the callee may store what it returns, or one of its entity or liste arguments, in another of
+		// them
+		auto isPointer = [](Value* argV) { return argV->getType()->isPointerTy(); };
+		auto numPointerArgs = std::count_if(ArgsV.begin(), ArgsV.end(), isPointer);
+		if ((numPointerArgs > 1) or (numPointerArgs and fn->getReturnType()->isPointerTy())) {
+			for (auto argV : ArgsV) {
+				if (isPointer(argV)) irGenAide::escapeIterations(argV);
+			}
+		}
+
+		if (fn->getReturnType()->isPointerTy()) {
+			// the returned entity or liste lives in the arena and is released along with our own
+			// allocations
+			irGenAide::markArena();
+		}
+
 		return Attr::Builder.CreateCall(fn, ArgsV);
 	}
 
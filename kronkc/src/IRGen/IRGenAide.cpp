@@ -1,5 +1,10 @@
 #include "IRGenAide.h"
 
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/MDBuilder.h>
+
 #include "Names.h"
 
 
@@ -8,6 +13,8 @@ namespace irGenAide {
 // Error Logging
 LLVM_ATTRIBUTE_NORETURN
 void LogCodeGenError(std::string errMsg) {
+	LogEarlierErrors();
+
 	outs() << "Code Generation Error in " << names::getModuleFile().filename() << '\n'
 	       << "[Line " << (Attr::CurrentLexerLine - Attr::IRGenLineOffset - 1) << "]: " << errMsg
 	       << '\n';
@@ -18,6 +25,10 @@ void LogCodeGenError(std::string errMsg) {
 
 // Tries the int<--->double implicit cast on rhsV
 Value* DoubletoIntCast(Value* v) {
+	if (auto intV = exactIntOf(v)) {
+		return intV;
+	}
+
 	return Attr::Builder.CreateCast(Instruction::FPToSI, v, Attr::Builder.getInt64Ty());
 }
 
@@ -26,10 +37,332 @@ Value* InttoDoubleCast(Value* v) {
 }
 
 
+// Converts an i64 that a reel holds exactly (a liste size, an integral variable) to a reel. Unlike other
+// reels, these can be converted back to the i64 for free, see exactIntOf.
+Value* exactInttoDoubleCast(Value* v) {
+	auto reelV = InttoDoubleCast(v);
+	if (auto cast = dyn_cast<Instruction>(reelV)) {
+		cast->setMetadata("kronk.exact", MDNode::get(Attr::Context, {}));
+	}
+
+	return reelV;
+}
+
+
+// Returns the i64 whose value the reel v holds, if it is known without a conversion. Otherwise nullptr.
+Value* exactIntOf(Value* v) {
+	if (auto cast = dyn_cast<SIToFPInst>(v); cast and cast->getMetadata("kronk.exact")) {
+		return cast->getOperand(0);
+	}
+
+	if (auto literal = dyn_cast<ConstantFP>(v)) {
+		auto& value = literal->getValueAPF();
+		if (value.isInteger() and (std::abs(value.convertToDouble()) <= (1ll << 53))) {
+			auto intValue = static_cast<int64_t>(value.convertToDouble());
+			return ConstantInt::get(Attr::Builder.getInt64Ty(), intValue, true);
+		}
+	}
+
+	return nullptr;
+}
+
+
+// Number literals are reels, but those with an integral value (ex. 0, 42) are also valid entiers. If ty
+// is entier and v is such a literal, returns v as an entier constant. Otherwise returns v untouched.
+Value* coerceLiteral(Value* v, Type* ty) {
+	auto literal = dyn_cast<ConstantFP>(v);
+	if ((not literal) or (not types::isEntier(ty)) or (not literal->getValueAPF().isInteger())) {
+		return v;
+	}
+
+	auto value = static_cast<int64_t>(literal->getValueAPF().convertToDouble());
+	return ConstantInt::get(Attr::Builder.getInt64Ty(), value, true);
+}
+
+
+// exponents up to this are expanded into multiplications
+static const int64_t MaxExpandedExponent = 32;
+
+
+// Emits base ** exponent. An integral exponent known at compile time is expanded into multiplications
+// by squaring, ex x ** 2 -> x * x, through llvm.powi for reels. Otherwise it's llvm.pow, which llvm can
+// still fold and vectorize unlike a call to the runtime.
+Value* emitPow(Value* baseV, Value* exponentV) {
+	if (types::isEntier(baseV)) {
+		auto exponent = dyn_cast<ConstantInt>(exponentV);
+		if ((not exponent) or exponent->isNegative() or
+		    (exponent->getSExtValue() > MaxExpandedExponent)) {
+			// negative exponents give fractions, which are truncated like the runtime used to do
+			auto powV = emitPow(InttoDoubleCast(baseV), InttoDoubleCast(exponentV));
+			return DoubletoIntCast(powV);
+		}
+
+		Value* resultV = getConstantInt(1);
+		for (auto n = exponent->getZExtValue(); n; n >>= 1) {
+			if (n & 1) resultV = Attr::Builder.CreateMul(resultV, baseV);
+			if (n > 1) baseV = Attr::Builder.CreateMul(baseV, baseV);
+		}
+
+		return resultV;
+	}
+
+	if (auto exponent = dyn_cast<ConstantFP>(exponentV)) {
+		auto& value = exponent->getValueAPF();
+		if (value.isInteger() and (std::abs(value.convertToDouble()) <= MaxExpandedExponent)) {
+			auto n = static_cast<int32_t>(value.convertToDouble());
+			return Attr::Builder.CreateIntrinsic(Intrinsic::powi, { baseV->getType() },
+			                                     { baseV, Attr::Builder.getInt32(n) });
+		}
+	}
+
+	return Attr::Builder.CreateBinaryIntrinsic(Intrinsic::pow, baseV, exponentV);
+}
+
+
+// The fast math flags of --rapide-math and @rapide functions. They let llvm reassociate reel arithmetic,
+// which it needs to vectorize sums, fuse multiplications and additions into fmas and approximate math
+// functions. Nan and infinite reels are still handled unless --sans-nan-inf is given.
+FastMathFlags getRapideMathFlags() {
+	FastMathFlags flags;
+	flags.setAllowReassoc();
+	flags.setAllowContract(true);
+	flags.setApproxFunc();
+	flags.setNoSignedZeros();
+
+	if (Attr::SANS_NAN_INF) {
+		flags.setNoNaNs();
+		flags.setNoInfs();
+	}
+
+	return flags;
+}
+
+
 // Construct a 64 bit signed int //
 Value* getConstantInt(int value) { return ConstantInt::get(Attr::Builder.getInt64Ty(), value, true); }
 
 
+// Emits an alloca in the entry block of the function being generated. Allocas outside the entry block
+// are not promoted to registers by mem2reg/SROA, and inside loops they grow the stack on every iteration.
+AllocaInst* createEntryBlockAlloca(Type* ty, Value* arraySize) {
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	auto& entryBB = currFunction->getEntryBlock();
+
+	IRBuilder<> entryBuilder(&entryBB, entryBB.begin());
+	return entryBuilder.CreateAlloca(ty, arraySize);
+}
+
+
+// Allocates memory for numElems values of type ty (or a single value if numElems is null) and returns a
+// pointer to it. Fixed size allocations that happen at most once per function call are hoisted to the
+// entry block. Dynamically sized ones, ones inside a loop and ones that may be returned to the caller
+// come from the runtime's arena.
+Value* allocateMemory(Type* ty, Value* numElems) {
+	bool isFixedSize = (not numElems) or isa<Constant>(numElems);
+
+	if (isFixedSize and Attr::ScopeStack.back()->Iterations.empty() and (not returnsAggregate())) {
+		return createEntryBlockAlloca(ty, numElems);
+	}
+
+	markArena();
+
+	auto tySize = Attr::ThisModule->getDataLayout().getTypeAllocSize(ty).getFixedSize();
+	auto numBytesV = Attr::Builder.CreateMul((numElems) ? numElems : getConstantInt(1), getConstantInt(tySize));
+
+	auto mem = cast<CallInst>(emitRtCompilerUtilCall("_kronk_alloc", { numBytesV }));
+
+	// the memory is fresh, so it doesn't alias anything the function already has a pointer to
+	mem->addAttribute(AttributeList::ReturnIndex, Attribute::NoAlias);
+	mem->addAttribute(AttributeList::ReturnIndex, Attribute::NonNull);
+
+	return Attr::Builder.CreateBitCast(mem, ty->getPointerTo());
+}
+
+
+// Whether the function being generated returns an entity or a liste. Its arena allocations then outlive
+// it and are released by the caller instead.
+bool returnsAggregate() {
+	auto returnValue = Attr::ScopeStack.back()->returnValue;
+	return returnValue and returnValue->getType()->getPointerElementType()->isPointerTy();
+}
+
+
+// Marks the arena in the entry block of the function being generated, if it isn't marked already.
+// Must be called for every arena allocation, so the enclosing loop knows its iterations allocate.
+void markArena() {
+	auto& scope = Attr::ScopeStack.back();
+	if (not scope->Iterations.empty()) {
+		scope->Iterations.back().allocates = true;
+	}
+
+	if (scope->arenaMark or returnsAggregate()) {
+		return;
+	}
+
+	auto& entryBB = Attr::Builder.GetInsertBlock()->getParent()->getEntryBlock();
+
+	IRBuilderBase::InsertPointGuard guard(Attr::Builder);
+	Attr::Builder.SetInsertPoint(&entryBB, entryBB.getFirstInsertionPt());
+	scope->arenaMark = emitRtCompilerUtilCall("_kronk_arena_mark", {});
+}
+
+
+// Releases the arena allocations made since the function was entered. Must be emitted in the exit block.
+void releaseArena() {
+	if (auto mark = Attr::ScopeStack.back()->arenaMark) {
+		emitRtCompilerUtilCall("_kronk_arena_release", { mark });
+	}
+}
+
+
+// Starts a loop whose iterations start at headerBB. What an iteration allocates from the arena is
+// released before the next one starts, unless it may have been stored somewhere that outlives the
+// iteration (see escapeIterations). It then stays until the enclosing iteration, or the function, ends.
+void beginIteration(BasicBlock* headerBB) {
+	auto& scope = Attr::ScopeStack.back();
+	scope->Iterations.push_back(
+	    { headerBB, scope->HeapAllocas.size(), scope->Views.size(), false, false, {} });
+}
+
+
+// Branches to the start of the next iteration of the enclosing loop starting at headerBB
+void emitNextIteration(BasicBlock* headerBB) {
+	auto& iterations = Attr::ScopeStack.back()->Iterations;
+	auto it = std::find_if(iterations.rbegin(), iterations.rend(),
+	                       [headerBB](auto& iteration) { return iteration.headerBB == headerBB; });
+
+	it->backEdges.push_back(Attr::Builder.CreateBr(headerBB));
+}
+
+
+// Ends the innermost loop, once all of it is generated since we only know then whether its allocations
+// escape
+void endIteration() {
+	auto& iterations = Attr::ScopeStack.back()->Iterations;
+	auto iteration = std::move(iterations.back());
+	iterations.pop_back();
+
+	IRBuilderBase::InsertPointGuard guard(Attr::Builder);
+
+	// the slices the iteration made die with it
+	for (auto backEdge : iteration.backEdges) {
+		Attr::Builder.SetInsertPoint(backEdge);
+		emitDropViews(iteration.firstView);
+	}
+
+	if (not iteration.allocates) return;
+
+	// the last iteration leaves the loop without releasing, so the enclosing iteration allocates too
+	markArena();
+
+	if (iteration.escapes) return;
+
+	auto headerBB = iteration.headerBB;
+	Attr::Builder.SetInsertPoint(headerBB, headerBB->getFirstInsertionPt());
+	auto mark = emitRtCompilerUtilCall("_kronk_arena_mark", {});
+
+	for (auto backEdge : iteration.backEdges) {
+		Attr::Builder.SetInsertPoint(backEdge);
+		emitRtCompilerUtilCall("_kronk_arena_release", { mark });
+	}
+}
+
+
+// Records the slice at viewPtr, which was just made. Its slot is null until then, so the slice only
+// drops its reference if it was made.
+void recordView(Value* viewPtr) {
+	auto slot = createEntryBlockAlloca(viewPtr->getType());
+
+	IRBuilder<> entryBuilder(slot->getParent(), ++slot->getIterator());
+	entryBuilder.CreateStore(Constant::getNullValue(viewPtr->getType()), slot);
+
+	Attr::Builder.CreateStore(viewPtr, slot);
+	Attr::ScopeStack.back()->Views.push_back({ viewPtr, slot });
+}
+
+
+// Whether ptr (a slice, or a cast of it) is only read and written through. Once it is stored somewhere,
+// or handed to a function that may keep it, it may outlive its scope.
+static bool isOnlyAccessed(Value* ptr, AllocaInst* slot) {
+	for (auto user : ptr->users()) {
+		if (isa<GetElementPtrInst>(user) or isa<LoadInst>(user)) continue;
+
+		if (auto store = dyn_cast<StoreInst>(user)) {
+			if ((store->getValueOperand() == ptr) and (store->getPointerOperand() != slot)) return false;
+		}
+
+		else if (auto cast = dyn_cast<BitCastInst>(user)) {
+			if (not isOnlyAccessed(cast, slot)) return false;
+		}
+
+		else if (auto call = dyn_cast<CallInst>(user)) {
+			// the runtime's liste functions and llvm's memcpy don't keep their arguments. Like anywhere
+			// else (see FunctionCallExpr::codegen), other functions may store one argument in another,
+			// or return it
+			auto callee = call->getCalledFunction();
+			if (callee and (callee->isIntrinsic() or callee->getName().startswith("_kronk_"))) continue;
+
+			auto isPointer = [](Value* argV) { return argV->getType()->isPointerTy(); };
+			if ((not callee) or callee->getReturnType()->isPointerTy() or
+			    (std::count_if(call->arg_begin(), call->arg_end(), isPointer) > 1)) {
+				return false;
+			}
+		}
+
+		else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Drops the references of the slices made since Views[firstView], unless they may outlive their scope.
+// Otherwise the next write to the liste they were taken from would copy its elements. Must be emitted
+// where these slices die, at the end of a loop iteration or in the exit block.
+void emitDropViews(size_t firstView) {
+	auto& views = Attr::ScopeStack.back()->Views;
+
+	for (auto i = firstView; i < views.size(); ++i) {
+		auto [viewPtr, slot] = views[i];
+		if (not isOnlyAccessed(viewPtr, slot)) continue;
+
+		auto viewV = Attr::Builder.CreateLoad(slot);
+		emitRtCompilerUtilCall("_kronk_list_drop",
+		                       { Attr::Builder.CreateBitCast(viewV, Attr::Builder.getInt8PtrTy()) });
+		Attr::Builder.CreateStore(Constant::getNullValue(viewV->getType()), slot);
+	}
+}
+
+
+// The number of enclosing loops whose current iteration made the entity or liste at ptr. Anything that
+// isn't one of the HeapAllocas, like an argument or what a call returns, is taken to outlive them all.
+static size_t iterationLevel(Value* ptr) {
+	auto& scope = Attr::ScopeStack.back();
+	auto it = std::find(scope->HeapAllocas.begin(), scope->HeapAllocas.end(), ptr);
+	if (it == scope->HeapAllocas.end()) return 0;
+
+	size_t idx = it - scope->HeapAllocas.begin();
+	size_t level = 0;
+	while ((level < scope->Iterations.size()) and (scope->Iterations[level].firstHeapAlloca <= idx)) {
+		level++;
+	}
+
+	return level;
+}
+
+
+// Records that memory allocated in the current iteration may be stored in the entity or liste at ptr (or
+// anywhere, if ptr is null). The iterations ptr outlives then can't release their allocations.
+void escapeIterations(Value* ptr) {
+	auto& iterations = Attr::ScopeStack.back()->Iterations;
+	for (size_t i = (ptr) ? iterationLevel(ptr) : 0; i < iterations.size(); ++i) {
+		iterations[i].escapes = true;
+	}
+}
+
+
 /// Helper function for emiting GEP instructions
 Value* getGEPAt(Value* alloc, Value* idxV, bool isDataPtr) {
 	if (isDataPtr) {
@@ -63,7 +396,7 @@ void deepCopy(Value* enttyPtr) {
 		if (auto fieldTy = types::isEnttyPtr(enttypeTy->getElementType(idx))) {
 			auto fieldAddr = getGEPAt(enttyPtr, getConstantInt(idx));
 			auto fieldPtr = Attr::Builder.CreateLoad(fieldAddr);
-			AllocaInst* alloc = Attr::Builder.CreateAlloca(fieldTy);
+			auto alloc = allocateMemory(fieldTy);
 
 			copyEntty(alloc, fieldPtr);
 			Attr::Builder.CreateStore(alloc, fieldAddr);
@@ -73,29 +406,34 @@ void deepCopy(Value* enttyPtr) {
 
 
 void copyEntty(Value* dst, Value* src) {
-	emitMemcpy(dst, src, getConstantInt(1));  // there's just one element of this type
-
-	// also copy data values if src is a liste
+	// the data block of a liste isn't copied. The copy shares it with src until either of them modifies
+	// it (see emitListMakeUnique)
 	if (types::isListePtr(src)) {
-		auto dstDataPtr = Attr::Builder.CreateLoad(getGEPAt(dst, getConstantInt(1)));
-		auto srcDataPtr = Attr::Builder.CreateLoad(getGEPAt(src, getConstantInt(1)));
+		emitListShare(src);
+		emitMemcpy(dst, src, getConstantInt(1));  // there's just one element of this type
+
+		// the copy must not append into the spare capacity of src's data block
 		auto srcDataSize = Attr::Builder.CreateLoad(getGEPAt(src, getConstantInt(0)));
-		emitMemcpy(dstDataPtr, srcDataPtr, srcDataSize);
+		Attr::Builder.CreateStore(srcDataSize, getGEPAt(dst, getConstantInt(2)));
 
 		return;  // kronk doesn't deep copy list elements
 	}
 
+	emitMemcpy(dst, src, getConstantInt(1));
 	deepCopy(dst);
 }
 
 
 // Helper function for filling the members of a list entity. Also fills the data block
-// if the values are supplied
+// if the values are supplied. Members that aren't supplied are zeroed.
 void fillUpListEntty(Value* listPtr, std::vector<Value*> members, std::vector<Value*> dataValues) {
 	// fill entity members
-	for (int i = 0; i < 2; ++i) {
+	auto listTy = cast<StructType>(listPtr->getType()->getPointerElementType());
+	for (int i = 0; i < listTy->getNumElements(); ++i) {
 		auto fieldAddr = irGenAide::getGEPAt(listPtr, irGenAide::getConstantInt(i));
-		Attr::Builder.CreateStore(members[i], fieldAddr);
+		auto memberV =
+		    (i < members.size()) ? members[i] : Constant::getNullValue(listTy->getElementType(i));
+		Attr::Builder.CreateStore(memberV, fieldAddr);
 	}
 
 	// fill data block if data values are passed
@@ -108,31 +446,395 @@ void fillUpListEntty(Value* listPtr, std::vector<Value*> members, std::vector<Va
 }
 
 
+// Whether the liste at listPtr was created in the function being generated. Memory for such a liste can
+// come from the arena (which is then marked), it is released along with the liste. Any other liste may
+// outlive this function. In a loop, a liste made by an earlier iteration also outlives the current one.
+// The top level code then gives it memory from malloc, so the iteration can still release its own.
+bool isFrameLocalList(Value* listPtr) {
+	auto& scope = Attr::ScopeStack.back();
+	bool isInMain = Attr::ScopeStack.size() == 1;
+	bool isLocal = isInMain or
+	               (std::find(scope->HeapAllocas.begin(), scope->HeapAllocas.end(), listPtr) !=
+	                scope->HeapAllocas.end());
+
+	if (not isLocal) return false;
+
+	if (auto level = iterationLevel(listPtr); level < scope->Iterations.size()) {
+		if (isInMain and (level == 0)) return false;
+		escapeIterations(listPtr);
+	}
+
+	markArena();
+	return true;
+}
+
+
+Value* getListElemSize(Value* listPtr) {
+	auto dataPtrTy = cast<StructType>(listPtr->getType()->getPointerElementType())->getElementType(1);
+	auto elemSize = Attr::ThisModule->getDataLayout()
+	                    .getTypeAllocSize(dataPtrTy->getPointerElementType())
+	                    .getFixedSize();
+
+	return getConstantInt(elemSize);
+}
+
+
+// Whether the elements of the liste at listPtr are entities or listes
+static bool hasPointerElems(Value* listPtr) {
+	auto dataPtrTy = cast<StructType>(listPtr->getType()->getPointerElementType())->getElementType(1);
+	return dataPtrTy->getPointerElementType()->isPointerTy();
+}
+
+
+// Called after an entity or liste is copied into the one at dst. If dst outlives the current iteration
+// and is a liste of the top level code, it gets its own copy of the elements from malloc so the
+// iteration can still release. Otherwise see escapeIterations.
+void emitCopyOutOfIteration(Value* dst) {
+	auto level = iterationLevel(dst);
+	if (level == Attr::ScopeStack.back()->Iterations.size()) return;
+
+	bool isInMain = Attr::ScopeStack.size() == 1;
+	if ((not isInMain) or (level != 0) or (not types::isListePtr(dst)) or hasPointerElems(dst)) {
+		escapeIterations(dst);
+		return;
+	}
+
+	emitRtCompilerUtilCall("_kronk_list_make_unique",
+	                       { Attr::Builder.CreateBitCast(dst, Attr::Builder.getInt8PtrTy()),
+	                         getListElemSize(dst), Attr::Builder.getInt1(false) });
+}
+
+
+// Makes sure the data block of the liste at listPtr can hold minCapacityV elements. If it can't, the
+// runtime moves the elements to a bigger data block.
+void emitListReserve(Value* listPtr, Value* minCapacityV) {
+	auto capacityV = Attr::Builder.CreateLoad(getGEPAt(listPtr, getConstantInt(2)));
+
+	// growing the data block is rare, so we only call into the runtime when it's needed
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	auto GrowBB = BasicBlock::Create(Attr::Context, "liste.grow", currFunction);
+	auto ContBB = BasicBlock::Create(Attr::Context, "liste.grow.cont", currFunction);
+
+	Attr::Builder.CreateCondBr(Attr::Builder.CreateICmpSGT(minCapacityV, capacityV), GrowBB, ContBB);
+
+	Attr::Builder.SetInsertPoint(GrowBB);
+	emitRtCompilerUtilCall("_kronk_list_reserve",
+	                       { Attr::Builder.CreateBitCast(listPtr, Attr::Builder.getInt8PtrTy()),
+	                         getListElemSize(listPtr), minCapacityV,
+	                         Attr::Builder.getInt1(isFrameLocalList(listPtr)) });
+	Attr::Builder.CreateBr(ContBB);
+
+	Attr::Builder.SetInsertPoint(ContBB);
+}
+
+
+// Gives the liste at listPtr its own copy of its elements if it shares its data block with other listes
+// (copies or slices of it), before the elements are modified. Writes to a data block nobody else refers
+// to anymore don't copy anything.
+void emitListMakeUnique(Value* listPtr) {
+	auto refsV = Attr::Builder.CreateLoad(getGEPAt(listPtr, getConstantInt(3)));
+
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	auto SharedBB = BasicBlock::Create(Attr::Context, "liste.shared", currFunction);
+	auto CopyBB = BasicBlock::Create(Attr::Context, "liste.cow", currFunction);
+	auto ContBB = BasicBlock::Create(Attr::Context, "liste.cow.cont", currFunction);
+
+	Attr::Builder.CreateCondBr(Attr::Builder.CreateIsNull(refsV), ContBB, SharedBB);
+
+	Attr::Builder.SetInsertPoint(SharedBB);
+	auto isSharedV = Attr::Builder.CreateICmpSGT(Attr::Builder.CreateLoad(refsV), getConstantInt(1));
+	Attr::Builder.CreateCondBr(isSharedV, CopyBB, ContBB);
+
+	Attr::Builder.SetInsertPoint(CopyBB);
+	emitRtCompilerUtilCall("_kronk_list_make_unique",
+	                       { Attr::Builder.CreateBitCast(listPtr, Attr::Builder.getInt8PtrTy()),
+	                         getListElemSize(listPtr),
+	                         Attr::Builder.getInt1(isFrameLocalList(listPtr)) });
+	Attr::Builder.CreateBr(ContBB);
+
+	Attr::Builder.SetInsertPoint(ContBB);
+}
+
+
+// Records that one more liste (a copy or a slice of the liste at listPtr) refers to its data block.
+void emitListShare(Value* listPtr) {
+	auto refsAddr = getGEPAt(listPtr, getConstantInt(3));
+	auto refsV = Attr::Builder.CreateLoad(refsAddr);
+
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	auto NewRefsBB = BasicBlock::Create(Attr::Context, "liste.share.new", currFunction);
+	auto IncRefsBB = BasicBlock::Create(Attr::Context, "liste.share.inc", currFunction);
+	auto ContBB = BasicBlock::Create(Attr::Context, "liste.share.cont", currFunction);
+
+	Attr::Builder.CreateCondBr(Attr::Builder.CreateIsNull(refsV), NewRefsBB, IncRefsBB);
+
+	// the first time the data block is shared, the runtime allocates its reference count
+	Attr::Builder.SetInsertPoint(NewRefsBB);
+	emitRtCompilerUtilCall("_kronk_list_share",
+	                       { Attr::Builder.CreateBitCast(listPtr, Attr::Builder.getInt8PtrTy()),
+	                         Attr::Builder.getInt1(isFrameLocalList(listPtr)) });
+	Attr::Builder.CreateBr(ContBB);
+
+	Attr::Builder.SetInsertPoint(IncRefsBB);
+	auto refCountV = Attr::Builder.CreateLoad(refsV);
+	Attr::Builder.CreateStore(Attr::Builder.CreateAdd(refCountV, getConstantInt(1)), refsV);
+	Attr::Builder.CreateBr(ContBB);
+
+	Attr::Builder.SetInsertPoint(ContBB);
+}
+
+
+// Appends valueV, which must be of the liste's element type, to the liste at listPtr
+void emitListAppend(Value* listPtr, Value* valueV) {
+	auto sizeAddr = getGEPAt(listPtr, getConstantInt(0));
+	auto newSizeV = Attr::Builder.CreateAdd(Attr::Builder.CreateLoad(sizeAddr), getConstantInt(1));
+
+	emitListReserve(listPtr, newSizeV);
+
+	if (hasPointerElems(listPtr)) {
+		escapeIterations(listPtr);
+	}
+
+	auto dataPtr = Attr::Builder.CreateLoad(getGEPAt(listPtr, getConstantInt(1)));
+	auto sizeV = Attr::Builder.CreateLoad(sizeAddr);
+	Attr::Builder.CreateStore(valueV, getGEPAt(dataPtr, sizeV, true));
+	Attr::Builder.CreateStore(newSizeV, sizeAddr);
+}
+
+
+// Appends the elements of the liste at srcListPtr to the liste at listPtr. Both may be the same liste
+void emitListExtend(Value* listPtr, Value* srcListPtr) {
+	auto sizeAddr = getGEPAt(listPtr, getConstantInt(0));
+	auto srcSizeV = Attr::Builder.CreateLoad(getGEPAt(srcListPtr, getConstantInt(0)));
+	auto newSizeV = Attr::Builder.CreateAdd(Attr::Builder.CreateLoad(sizeAddr), srcSizeV);
+
+	emitListReserve(listPtr, newSizeV);
+
+	if (hasPointerElems(listPtr)) {
+		escapeIterations(listPtr);
+	}
+
+	// reserving may have moved the data blocks, so we load them afterwards
+	auto dataPtr = Attr::Builder.CreateLoad(getGEPAt(listPtr, getConstantInt(1)));
+	auto srcDataPtr = Attr::Builder.CreateLoad(getGEPAt(srcListPtr, getConstantInt(1)));
+	auto sizeV = Attr::Builder.CreateLoad(sizeAddr);
+
+	emitMemcpy(getGEPAt(dataPtr, sizeV, true), srcDataPtr, srcSizeV);
+	Attr::Builder.CreateStore(newSizeV, sizeAddr);
+}
+
+
+// Creates a liste whose elements are the constant array dataV. The elements live in a private constant
+// global, shared by all identical literals of the module, and aren't copied until the liste is modified.
+Value* createLiteralList(Constant* dataV) {
+	auto dataTy = cast<ArrayType>(dataV->getType());
+
+	// identical constants are the same Constant*, so a name derived from the elements finds the global
+	// of an identical literal
+	std::string contents;
+	raw_string_ostream contentsStream(contents);
+	dataV->printAsOperand(contentsStream, true, Attr::ThisModule.get());
+	auto name = ".kronk.literal." + utohexstr(hash_value(contentsStream.str()));
+
+	auto dataGlobal = Attr::ThisModule->getNamedGlobal(name);
+	if ((not dataGlobal) or (dataGlobal->getInitializer() != dataV)) {
+		dataGlobal = new GlobalVariable(*Attr::ThisModule, dataTy, /* isConstant */ true,
+		                                GlobalValue::PrivateLinkage, dataV, name);
+		dataGlobal->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+	}
+
+	// the data block of a literal is never written to. Its reference count is shared by all literals of
+	// the module and starts too high to ever drop to 1, so modifying a literal's elements copies them.
+	auto refsGlobal = Attr::ThisModule->getNamedGlobal(".kronk.literal.refs");
+	if (not refsGlobal) {
+		refsGlobal = new GlobalVariable(*Attr::ThisModule, Attr::Builder.getInt64Ty(), false,
+		                                GlobalValue::PrivateLinkage,
+		                                ConstantInt::get(Attr::Builder.getInt64Ty(), INT64_MAX / 2),
+		                                ".kronk.literal.refs");
+	}
+
+	auto sizeV = getConstantInt(dataTy->getNumElements());
+	auto dataPtr = Attr::Builder.CreateConstInBoundsGEP2_64(dataGlobal, 0, 0);
+
+	auto lstPtr = allocateMemory(types::getListeType(dataPtr->getType()));
+	fillUpListEntty(lstPtr, { sizeV, dataPtr, sizeV, refsGlobal });
+	Attr::ScopeStack.back()->HeapAllocas.push_back(lstPtr);
+
+	return lstPtr;
+}
+
+
+// names of the fields of a liste, see types::getListeType
+static const std::array<std::string, 4> ListeFields = { "size", "data", "capacity", "refs" };
+
+
+// Attaches tbaa metadata to the loads and stores of fn that access the header or the elements of a
+// liste, or a field of an entity. Each of these gets its own type in the kronk tbaa hierarchy (elements
+// get one per element type), so llvm knows for instance that storing an element doesn't change the size
+// or the data pointer of a liste, and can keep those in registers across a loop.
+void annotateMemoryAccesses(Function* fn) {
+	MDBuilder mdBuilder(Attr::Context);
+	auto root = mdBuilder.createTBAARoot("kronk tbaa");
+
+	for (auto& inst : instructions(fn)) {
+		Value* ptr;
+		if (auto load = dyn_cast<LoadInst>(&inst)) {
+			ptr = load->getPointerOperand();
+		}
+
+		else if (auto store = dyn_cast<StoreInst>(&inst)) {
+			ptr = store->getPointerOperand();
+		}
+
+		else {
+			continue;
+		}
+
+		// accesses of whole entities and listes are left alone. They overlap the fields.
+		auto gep = dyn_cast<GetElementPtrInst>(ptr);
+		if ((not gep) or ptr->getType()->getPointerElementType()->isAggregateType()) {
+			continue;
+		}
+
+		std::string typeName;
+		auto sourceTy = gep->getSourceElementType();
+
+		if (auto structTy = dyn_cast<StructType>(sourceTy)) {
+			if ((gep->getNumIndices() != 2) or (not gep->hasAllConstantIndices())) continue;
+			auto field = cast<ConstantInt>(gep->getOperand(2))->getZExtValue();
+
+			if (structTy->isLiteral()) {
+				typeName = "liste." + ListeFields[field];
+
+				// a liste's data pointer is never null, even when it holds no elements
+				if ((field == 1) and isa<LoadInst>(&inst)) {
+					inst.setMetadata(LLVMContext::MD_nonnull, MDNode::get(Attr::Context, {}));
+				}
+			}
+
+			else {
+				typeName = structTy->getName().str() + "." + std::to_string(field);
+			}
+		}
+
+		else if (gep->getNumIndices() == 1) {
+			// only the elements of a liste's data block are accessed through a single index
+			std::string elemTyStr;
+			raw_string_ostream elemTyStream(elemTyStr);
+			sourceTy->print(elemTyStream);
+
+			typeName = "liste.elem." + elemTyStream.str();
+		}
+
+		else {
+			continue;
+		}
+
+		auto typeNode = mdBuilder.createTBAAScalarTypeNode(typeName, root);
+		inst.setMetadata(LLVMContext::MD_tbaa, mdBuilder.createTBAAStructTagNode(typeNode, typeNode, 0));
+	}
+}
+
+
 // Used to get functions in kronkrt modules
 Function* getRtModuleFn(std::string name) {
 	auto fn = Attr::Kronkrt->getFunction(name);
-	Attr::ThisModule->getOrInsertFunction(fn->getName(), fn->getFunctionType());
+	// the attributes of the runtime functions (noalias results, noreturn error paths..) go along with
+	// their declarations
+	Attr::ThisModule->getOrInsertFunction(fn->getName(), fn->getFunctionType(), fn->getAttributes());
 
 	return fn;
 }
 
 
-// Used to emit runtime checks ex for list indices
-void emitRtCheck(std::string name, std::vector<Value*> Args) {
-	auto fn = Attr::Kronkrt->getFunction(name);
-	Attr::ThisModule->getOrInsertFunction(fn->getName(), fn->getFunctionType());
+// Returns the block of the current function that reports failed runtime checks. All the checks of a
+// function share it, passing it the kind of check, where it is and the size of the liste involved, if
+// any, through phis.
+static BasicBlock* getTrapBlock() {
+	auto scope = Attr::ScopeStack.back().get();
+	if (scope->trapBB) {
+		return scope->trapBB;
+	}
+
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	scope->trapBB = BasicBlock::Create(Attr::Context, "kronk.trap", currFunction);
 
-	Args.push_back(Attr::Builder.CreateGlobalStringPtr(names::getModuleFile().filename().string()));
-	Args.push_back(getConstantInt(Attr::CurrentLexerLine - Attr::IRGenLineOffset - 1));
+	IRBuilderBase::InsertPointGuard guard(Attr::Builder);
+	Attr::Builder.SetInsertPoint(scope->trapBB);
+
+	auto kindV = Attr::Builder.CreatePHI(Attr::Builder.getInt32Ty(), 2, "kind");
+	auto siteV = Attr::Builder.CreatePHI(Attr::Builder.getInt32Ty(), 2, "site");
+	auto listSizeV = Attr::Builder.CreatePHI(Attr::Builder.getInt64Ty(), 2, "size");
+
+	Attr::Builder.CreateCall(getRtModuleFn("_kronk_rt_trap"), { kindV, siteV, listSizeV });
+	Attr::Builder.CreateUnreachable();
+
+	return scope->trapBB;
+}
+
+
+// Used to emit runtime checks ex for list indices. okV is the condition the check expects to hold. If
+// it doesn't, the program is stopped with an error reported at the current line. Returns the branch
+// of the check.
+BranchInst* emitRtCheck(RtCheck kind, Value* okV, Value* listSizeV) {
+	if (Attr::SANS_VERIFICATIONS) return nullptr;
+
+	auto trapBB = getTrapBlock();
+	auto checkBB = Attr::Builder.GetInsertBlock();
+	auto okBB = BasicBlock::Create(Attr::Context, "check.ok", checkBB->getParent());
+
+	// the site packs the file (see _kronk_source_files) in the upper 12 bits and the line of the check
+	// in the lower 20, anything bigger than that would be reported at the wrong place
+	size_t line = Attr::CurrentLexerLine - Attr::IRGenLineOffset - 1;
+	if (line > 0xFFFFF)
+		LogCodeGenError("Too many lines to report runtime errors, a source file can have at most "
+		                + std::to_string(0xFFFFF) + " lines");
+	if (Attr::SourceFileId > 0xFFF)
+		LogCodeGenError("Too many imported files to report runtime errors, a program can have at most "
+		                + std::to_string(0xFFF + 1) + " source files");
+	uint32_t site = (Attr::SourceFileId << 20) | static_cast<uint32_t>(line);
+
+	auto phi = trapBB->phis().begin();
+	(phi++)->addIncoming(Attr::Builder.getInt32(static_cast<uint32_t>(kind)), checkBB);
+	(phi++)->addIncoming(Attr::Builder.getInt32(site), checkBB);
+	phi->addIncoming(listSizeV ? listSizeV : getConstantInt(-1), checkBB);
+
+	auto expectedV = Attr::Builder.CreateIntrinsic(Intrinsic::expect, { okV->getType() },
+	                                               { okV, Attr::Builder.getTrue() });
+	auto check = Attr::Builder.CreateCondBr(expectedV, okBB, trapBB);
+
+	Attr::Builder.SetInsertPoint(okBB);
+	return check;
+}
+
+
+// Returns the index into a liste of size listSizeV that idxV refers to, counting negative indices from
+// the end of the liste.
+Value* emitFixIdx(Value* idxV, Value* listSizeV) {
+	auto isNegative = Attr::Builder.CreateICmpSLT(idxV, getConstantInt(0));
+	return Attr::Builder.CreateSelect(isNegative, Attr::Builder.CreateAdd(idxV, listSizeV), idxV);
+}
+
+
+// Emits the bounds check of an index into a liste and returns the fixed index (see emitFixIdx). Valid
+// indices are fixed into [0, size) and invalid ones aren't, so a single unsigned comparison checks the
+// index. The branch of the check is tagged so the bounds check elimination pass can find it.
+Value* emitListIdxCheck(Value* idxV, Value* listSizeV) {
+	auto fixedIdxV = emitFixIdx(idxV, listSizeV);
+	auto inBoundsV = Attr::Builder.CreateICmpULT(fixedIdxV, listSizeV);
+
+	if (auto check = emitRtCheck(RtCheck::INDEX, inBoundsV, listSizeV)) {
+		check->setMetadata("kronk.idx.check", MDNode::get(Attr::Context, {}));
+	}
 
-	Attr::Builder.CreateCall(fn, Args);
+	return fixedIdxV;
 }
 
 
 // Used to emit calls to runtime compiler util functions that are not checks
 Value* emitRtCompilerUtilCall(std::string name, std::vector<Value*> Args) {
 	auto fn = Attr::Kronkrt->getFunction(name);
-	Attr::ThisModule->getOrInsertFunction(fn->getName(), fn->getFunctionType());
+	Attr::ThisModule->getOrInsertFunction(fn->getName(), fn->getFunctionType(), fn->getAttributes());
 
 	return Attr::Builder.CreateCall(fn, Args);
 }
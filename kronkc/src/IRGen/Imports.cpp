@@ -14,6 +14,7 @@ static void saveCurrModuleState() {
 	currModuleState->BuilderInsertPoint = Attr::Builder.saveAndClearIP();
 	currModuleState->CurrentLexerLine = Attr::CurrentLexerLine;
 	currModuleState->ScopeStack = std::move(Attr::ScopeStack);
+	currModuleState->SourceFileId = Attr::SourceFileId;
 
 	Attr::SuspendedModuleStack.push_back(std::move(currModuleState));
 }
@@ -30,6 +31,7 @@ static void restoreCurrModuleState() {
 
 	Attr::CurrentLexerLine = lastModuleState->CurrentLexerLine;
 	Attr::ScopeStack = std::move(lastModuleState->ScopeStack);
+	Attr::SourceFileId = lastModuleState->SourceFileId;
 
 	Attr::Builder.restoreIP(lastModuleState->BuilderInsertPoint);
 }
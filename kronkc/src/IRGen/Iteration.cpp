@@ -19,6 +19,10 @@ Value* WhileStmt::codegen() {
 	// emit loop condition
 	Attr::Builder.CreateBr(CondBB);
 	Attr::Builder.SetInsertPoint(CondBB);
+
+	// the condition and the body are evaluated on every iteration
+	irGenAide::beginIteration(CondBB);
+
 	Value* CondV = Cond->codegen();
 
 	Attr::Builder.CreateCondBr(CondV, LoopBB, ExitBB);
@@ -29,7 +33,11 @@ Value* WhileStmt::codegen() {
 
 	Body->codegen();
 
-	Attr::Builder.CreateBr(CondBB);
+	if (not Attr::Builder.GetInsertBlock()->getTerminator()) {
+		irGenAide::emitNextIteration(CondBB);
+	}
+
+	irGenAide::endIteration();
 
 	// emit loop exit block
 	currentFunction->getBasicBlockList().push_back(ExitBB);
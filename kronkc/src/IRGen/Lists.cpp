@@ -1,3 +1,4 @@
+#include "Analysis.h"
 #include "IRGenAide.h"
 #include "Nodes.h"
 
@@ -27,11 +28,19 @@ Value* AnonymousList::codegen() {
 	auto sizeV = irGenAide::getConstantInt(initListV.size());
 	auto listElementType = initListV[0]->getType();
 
-	AllocaInst* dataPtr = Attr::Builder.CreateAlloca(listElementType, sizeV);
-	AllocaInst* lstPtr =
-	    Attr::Builder.CreateAlloca(StructType::get(Attr::Builder.getInt64Ty(), dataPtr->getType()));
+	if (std::all_of(initListV.begin(), initListV.end(), [](Value* v) { return isa<Constant>(v); })) {
+		// all elements are known at compile time. The liste refers to them in a constant global.
+		std::vector<Constant*> elements;
+		for (auto v : initListV) elements.push_back(cast<Constant>(v));
 
-	irGenAide::fillUpListEntty(lstPtr, { sizeV, dataPtr }, initListV);
+		auto dataV = ConstantArray::get(ArrayType::get(listElementType, elements.size()), elements);
+		return irGenAide::createLiteralList(dataV);
+	}
+
+	auto dataPtr = irGenAide::allocateMemory(listElementType, sizeV);
+	auto lstPtr = irGenAide::allocateMemory(types::getListeType(dataPtr->getType()));
+
+	irGenAide::fillUpListEntty(lstPtr, { sizeV, dataPtr, sizeV }, initListV);
 	Attr::ScopeStack.back()->HeapAllocas.push_back(lstPtr);
 
 	return lstPtr;
@@ -41,21 +50,8 @@ Value* AnonymousList::codegen() {
 Value* AnonymousString::codegen() {
 	LogProgress("Creating anonymous string");
 
-	std::vector<Value*> strV;
-	for (auto& strchar : str) {
-		strV.push_back(Attr::Builder.getInt8(strchar));
-	}
-
-	auto sizeV = irGenAide::getConstantInt(strV.size());
-
-	AllocaInst* dataPtr = Attr::Builder.CreateAlloca(Attr::Builder.getInt8Ty(), sizeV);
-	AllocaInst* lstPtr =
-	    Attr::Builder.CreateAlloca(StructType::get(Attr::Builder.getInt64Ty(), dataPtr->getType()));
-
-	irGenAide::fillUpListEntty(lstPtr, { sizeV, dataPtr }, strV);
-	Attr::ScopeStack.back()->HeapAllocas.push_back(lstPtr);
-
-	return lstPtr;
+	auto dataV = ConstantDataArray::getString(Attr::Context, str, /* AddNull */ false);
+	return irGenAide::createLiteralList(dataV);
 }
 
 
@@ -73,22 +69,27 @@ Value* ListConcatenation::codegen() {
 
 	auto newListSizeV = Attr::Builder.CreateAdd(Lsize, Rsize);
 	// The starting address of of the underlying memory block
-	AllocaInst* newDataPtr =
-	    Attr::Builder.CreateAlloca(LdataPtr->getType()->getPointerElementType(), newListSizeV);
+	auto newDataPtr =
+	    irGenAide::allocateMemory(LdataPtr->getType()->getPointerElementType(), newListSizeV);
 
 	// we now get all data from both listes in order
 	irGenAide::emitMemcpy(newDataPtr, LdataPtr, Lsize);
 	irGenAide::emitMemcpy(irGenAide::getGEPAt(newDataPtr, Lsize, true), RdataPtr, Rsize);
 
-	AllocaInst* newlistPtr =
-	    Attr::Builder.CreateAlloca(StructType::get(Attr::Builder.getInt64Ty(), newDataPtr->getType()));
+	auto newlistPtr = irGenAide::allocateMemory(types::getListeType(newDataPtr->getType()));
 
-	irGenAide::fillUpListEntty(newlistPtr, { newListSizeV, newDataPtr });
+	irGenAide::fillUpListEntty(newlistPtr, { newListSizeV, newDataPtr, newListSizeV });
 
 	return newlistPtr;
 }
 
 
+// indices made of integral variables are computed with integer arithmetic
+static Value* emitIndex(Node* idx) {
+	return analysis::isIntegralExpr(idx) ? analysis::emitIntegralExpr(idx) : idx->codegen();
+}
+
+
 Value* ListIdxRef::codegen() {
 	auto lstPtr = list->codegen();
 	if (not types::isListePtr(lstPtr)) {
@@ -98,15 +99,20 @@ Value* ListIdxRef::codegen() {
 
 	auto listSizeV = Attr::Builder.CreateLoad(irGenAide::getGEPAt(lstPtr, irGenAide::getConstantInt(0)));
 
-	auto idxV = idx->codegen();
-	// cast double to int (since all the nombre type in kronk is a double)
-	idxV = irGenAide::DoubletoIntCast(idxV);
+	auto idxV = emitIndex(idx.get());
+	// cast double to int, unless the index is already an entier
+	if (not types::isEntier(idxV)) {
+		idxV = irGenAide::DoubletoIntCast(idxV);
+	}
 
 	// we insert a runtime check to see if the index is in the list bounds
-	irGenAide::emitRtCheck("_kronk_list_idx_check", { idxV, listSizeV });
+	// and take care of negative indices
+	idxV = irGenAide::emitListIdxCheck(idxV, listSizeV);
 
-	// take care of negative indices
-	idxV = irGenAide::emitRtCompilerUtilCall("_kronk_list_fix_idx", { idxV, listSizeV });
+	if (not ctx) {
+		// we're about to modify an element, which must not be seen by the listes sharing the data block
+		irGenAide::emitListMakeUnique(lstPtr);
+	}
 
 	auto listDataPtr =
 	    Attr::Builder.CreateLoad(irGenAide::getGEPAt(lstPtr, irGenAide::getConstantInt(1)));
@@ -120,20 +126,20 @@ Value* ListIdxRef::codegen() {
 		//                       soit name = "joe"
 		//                       soit str = name[-1]
 		// str's value will be "e", a string in itself of size 1. Hence str is initialized as a string.
+		// The character is copied into it. Sharing name's data block would make the next write to name
+		// copy all of it.
 
 		if (ctx) {
 			// we're not modifying the string
 			auto sizeV = irGenAide::getConstantInt(1);
-			AllocaInst* dataPtr = Attr::Builder.CreateAlloca(Attr::Builder.getInt8Ty(), sizeV);
-			AllocaInst* lstPtr = Attr::Builder.CreateAlloca(
-			    StructType::get(Attr::Builder.getInt64Ty(), listDataPtr->getType()));
+			auto charPtr = irGenAide::allocateMemory(Attr::Builder.getInt8Ty(), sizeV);
+			Attr::Builder.CreateStore(Attr::Builder.CreateLoad(ptrToDataAtIdx), charPtr);
 
-			auto indexedChar = Attr::Builder.CreateLoad(ptrToDataAtIdx);
+			auto strPtr = irGenAide::allocateMemory(types::getListeType(charPtr->getType()));
+			irGenAide::fillUpListEntty(strPtr, { sizeV, charPtr, sizeV });
+			Attr::ScopeStack.back()->HeapAllocas.push_back(strPtr);
 
-			irGenAide::fillUpListEntty(lstPtr, { sizeV, dataPtr }, { indexedChar });
-			Attr::ScopeStack.back()->HeapAllocas.push_back(lstPtr);
-
-			return lstPtr;
+			return strPtr;
 		}
 
 		// we're modifying the character at idxV of the string
@@ -158,8 +164,8 @@ Value* ListSlice::codegen() {
 	auto listSizeV = Attr::Builder.CreateLoad(irGenAide::getGEPAt(lstPtr, irGenAide::getConstantInt(0)));
 
 	// first make sure start and end are valid indices given the list size
-	auto startV = start ? start->codegen() : irGenAide::getConstantInt(0);
-	auto endV = end ? end->codegen() : listSizeV;
+	auto startV = start ? emitIndex(start.get()) : irGenAide::getConstantInt(0);
+	auto endV = end ? emitIndex(end.get()) : listSizeV;
 
 	if (not startV->getType()->isIntegerTy(64)) {
 		startV = irGenAide::DoubletoIntCast(startV);
@@ -169,26 +175,36 @@ Value* ListSlice::codegen() {
 		endV = irGenAide::DoubletoIntCast(endV);
 	}
 
-	// we insert a runtime check to see if the slice is in the list bounds
-	irGenAide::emitRtCheck("_kronk_list_slice_check", { startV, endV, listSizeV });
-
 	// taking care of negative idx's
-	startV = irGenAide::emitRtCompilerUtilCall("_kronk_list_fix_idx", { startV, listSizeV });
-	endV = irGenAide::emitRtCompilerUtilCall("_kronk_list_fix_idx", { endV, listSizeV });
+	auto fixedStartV = irGenAide::emitFixIdx(startV, listSizeV);
+	auto fixedEndV = irGenAide::emitFixIdx(endV, listSizeV);
+
+	// we insert a runtime check to see if the slice is in the list bounds. Unlike an index, the start
+	// and end of a slice may be equal to the list size
+	auto inBoundsV = Attr::Builder.CreateAnd(Attr::Builder.CreateICmpULE(fixedStartV, listSizeV),
+	                                         Attr::Builder.CreateICmpULE(fixedEndV, listSizeV));
+	auto isOrderedV = Attr::Builder.CreateICmpSLE(fixedStartV, fixedEndV);
+	irGenAide::emitRtCheck(irGenAide::RtCheck::SLICE, Attr::Builder.CreateAnd(isOrderedV, inBoundsV),
+	                       listSizeV);
+
+	startV = fixedStartV;
+	endV = fixedEndV;
 
 	auto spliceSizeV = Attr::Builder.CreateSub(endV, startV);
 	auto oldDataPtr =
 	    Attr::Builder.CreateLoad(irGenAide::getGEPAt(lstPtr, irGenAide::getConstantInt(1)));
-	AllocaInst* newDataPtr =
-	    Attr::Builder.CreateAlloca(oldDataPtr->getType()->getPointerElementType(), spliceSizeV);
-
-	// transfer elements from original list to the splice
-	irGenAide::emitMemcpy(newDataPtr, oldDataPtr, spliceSizeV);
 
-	// build the list entity for the splice
-	AllocaInst* newlstPtr =
-	    Attr::Builder.CreateAlloca(StructType::get(Attr::Builder.getInt64Ty(), newDataPtr->getType()));
-	irGenAide::fillUpListEntty(newlstPtr, std::vector<Value*>{ spliceSizeV, newDataPtr });
+	// the splice is a view of the original list's elements. Nothing is copied until one of them modifies
+	// the data block they share, and the view gives its reference back when it dies.
+	irGenAide::emitListShare(lstPtr);
+	auto refsV = Attr::Builder.CreateLoad(irGenAide::getGEPAt(lstPtr, irGenAide::getConstantInt(3)));
+	auto newDataPtr = irGenAide::getGEPAt(oldDataPtr, startV, true);
+
+	auto newlstPtr = irGenAide::allocateMemory(types::getListeType(newDataPtr->getType()));
+	irGenAide::fillUpListEntty(newlstPtr,
+	                           std::vector<Value*>{ spliceSizeV, newDataPtr, spliceSizeV, refsV });
+	Attr::ScopeStack.back()->HeapAllocas.push_back(newlstPtr);
+	irGenAide::recordView(newlstPtr);
 
 	return newlstPtr;
 }
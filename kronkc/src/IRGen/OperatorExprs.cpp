@@ -1,3 +1,4 @@
+#include "Analysis.h"
 #include "IRGenAide.h"
 #include "Names.h"
 #include "Nodes.h"
@@ -25,9 +26,99 @@ static const std::unordered_map<std::string, uint8_t> OpIds = { { "non", 0 }, {
 	                                                            { "=", 21 } };
 
 
+static bool isComparison(uint8_t OpId) { return (OpId >= 13) and (OpId <= 18); }
+
+
+static Value* emitIntComparison(uint8_t OpId, Value* lhsV, Value* rhsV) {
+	static const CmpInst::Predicate IntPredicates[] = { CmpInst::ICMP_SLT, CmpInst::ICMP_SGT,
+		                                                CmpInst::ICMP_SLE, CmpInst::ICMP_SGE,
+		                                                CmpInst::ICMP_EQ,  CmpInst::ICMP_NE };
+
+	return Attr::Builder.CreateICmp(IntPredicates[OpId - 13], lhsV, rhsV);
+}
+
+
+// Integer division and remainder. Dividing INT64_MIN by -1 overflows, which sdiv and srem leave
+// undefined, so a divisor of -1 negates instead. The result wraps like the other entier arithmetic.
+static Value* emitIntDivision(bool isRemainder, Value* lhsV, Value* rhsV) {
+	// integer division by zero doesn't give inf like it does for reels, it traps
+	irGenAide::emitRtCheck(irGenAide::RtCheck::ZERO_DIVISION,
+	                       Attr::Builder.CreateICmpNE(rhsV, irGenAide::getConstantInt(0)));
+
+	auto isMinusOneV = Attr::Builder.CreateICmpEQ(rhsV, irGenAide::getConstantInt(-1));
+	auto divisorV = Attr::Builder.CreateSelect(isMinusOneV, irGenAide::getConstantInt(1), rhsV);
+
+	if (isRemainder) {
+		return Attr::Builder.CreateSelect(isMinusOneV, irGenAide::getConstantInt(0),
+		                                  Attr::Builder.CreateSRem(lhsV, divisorV));
+	}
+
+	return Attr::Builder.CreateSelect(isMinusOneV, Attr::Builder.CreateNeg(lhsV),
+	                                  Attr::Builder.CreateSDiv(lhsV, divisorV));
+}
+
+
+// Shifts past the width of an entier are poison in llvm, so the amount is taken modulo 64 like x86
+// shift instructions do
+static Value* emitIntShift(bool isLeft, Value* lhsV, Value* rhsV) {
+	auto amountV = Attr::Builder.CreateAnd(rhsV, irGenAide::getConstantInt(63));
+	return isLeft ? Attr::Builder.CreateShl(lhsV, amountV) : Attr::Builder.CreateAShr(lhsV, amountV);
+}
+
+
+// Lowers a = a + b, where a is a liste, to appending b to a in place. Without this, the accumulation
+// loop builds a new liste on every iteration and is quadratic. Returns nullptr if the assignment
+// doesn't have that form.
+Value* emitInPlaceAppend(Node* lhs, Node* rhs) {
+	auto lhsId = dynamic_cast<Identifier*>(lhs);
+	auto rhsExpr = dynamic_cast<BinaryExpr*>(rhs);
+
+	if ((not lhsId) or (not rhsExpr) or (rhsExpr->Op != "+")) {
+		return nullptr;
+	}
+
+	auto rhsLhsId = dynamic_cast<Identifier*>(rhsExpr->lhs.get());
+	if ((not rhsLhsId) or (rhsLhsId->name != lhsId->name)) {
+		return nullptr;
+	}
+
+	// the symbol table must point to the liste itself. For a liste parameter it points to a copy of the
+	// argument, and assigning to the parameter rebinds it rather than modifying the caller's liste.
+	auto& symbolTable = Attr::ScopeStack.back()->SymbolTable;
+	auto it = symbolTable.find(lhsId->name);
+
+	if ((it == symbolTable.end()) or (not types::isListePtr(it->second))) {
+		return nullptr;
+	}
+
+	auto listPtr = it->second;
+	auto rhsV = rhsExpr->rhs->codegen();
+
+	if (not types::isEqual(rhsV->getType(), listPtr->getType())) {
+		irGenAide::LogCodeGenError("Trying to concatenate lists with unequal types");
+	}
+
+	irGenAide::emitListExtend(listPtr, rhsV);
+	return listPtr;
+}
+
+
 Value* Assignment::codegen() {
 	LogProgress("Creating assignment");
 
+	if (auto appendV = emitInPlaceAppend(lhs.get(), rhs.get())) {
+		return appendV;
+	}
+
+	if (auto lhsId = dynamic_cast<Identifier*>(lhs.get());
+	    lhsId and Attr::ScopeStack.back()->IntegralVars.count(lhsId->name)) {
+		auto rhsV = analysis::emitIntegralExpr(rhs.get());
+		lhsId->injectCtx(0);
+		Attr::Builder.CreateStore(rhsV, lhsId->codegen());
+
+		return irGenAide::InttoDoubleCast(rhsV);
+	}
+
 	// first try to inject a store context into the left side be codegen 'ing it.
 	if (not lhs->injectCtx(0)) {
 		irGenAide::LogCodeGenError("Invalid expression on the left hand side of assigment");
@@ -57,12 +148,15 @@ Value* Assignment::codegen() {
 
 		if (lhsTy->isStructTy()) {
 			irGenAide::copyEntty(lhsV, rhsV);
+			irGenAide::emitCopyOutOfIteration(lhsV);
 			return lhsV;
 		}
 
-		AllocaInst* alloc = Attr::Builder.CreateAlloca(lvalueTy->getPointerElementType());
+		// we don't know what holds the slot at lhsV, so it may outlive every iteration
+		auto alloc = irGenAide::allocateMemory(lvalueTy->getPointerElementType());
 		irGenAide::copyEntty(alloc, rhsV);
 		Attr::Builder.CreateStore(alloc, lhsV);
+		irGenAide::escapeIterations(nullptr);
 		return alloc;
 	}
 
@@ -81,6 +175,9 @@ Value* Assignment::codegen() {
 
 	// lhsV & rhsV are both primitives
 
+	rhsV = irGenAide::coerceLiteral(rhsV, lhsTy);
+	rhsTy = rhsV->getType();
+
 	if (not types::isEqual(lhsTy, rhsTy)) {
 		irGenAide::LogCodeGenError("Operand types of assignment do not match");
 	}
@@ -117,20 +214,68 @@ Value* UnaryExpr::codegen() {
 		}
 	}
 
+	if (types::isEntier(rhsV)) {
+		switch (OpId) {
+			case 7:
+				return Attr::Builder.CreateNeg(rhsV);
+
+			case 1:
+				return Attr::Builder.CreateNot(rhsV);
+
+			default:
+				irGenAide::LogCodeGenError("Undefined unary operator << " + Op + " >> for an entier");
+		}
+	}
+
 	irGenAide::LogCodeGenError("Incompatible operand type for the unary operator << " + Op + " >>");
 }
 
 
-Value* BinaryExpr::codegen() {
-	auto OpId = OpIds.at(Op);
+// Emits `lhs et rhs` or `lhs ou rhs`. The right side is only evaluated if the left side doesn't decide
+// the result, so guards like  i < lst.size et lst[i] > 0  don't index out of bounds. When the right side
+// is cheap and has no side effects, simplifycfg turns the branch back into a select.
+static Value* emitLogicalOp(const std::string& Op, Node* lhs, Node* rhs) {
+	auto lhsV = lhs->codegen();
+	if (not types::isBool(lhsV)) {
+		irGenAide::LogCodeGenError("The operator << " + Op + " >> only applies to booleans");
+	}
 
-	if (OpId == 21) {
-		auto assn = std::make_unique<Assignment>(std::move(lhs), std::move(rhs));
-		return assn->codegen();
+	auto lhsBB = Attr::Builder.GetInsertBlock();
+	auto currFunction = lhsBB->getParent();
+	auto rhsBB = BasicBlock::Create(Attr::Context, Op + ".rhs", currFunction);
+	auto endBB = BasicBlock::Create(Attr::Context, Op + ".end", currFunction);
+
+	bool isAnd = (Op == "et");
+	if (isAnd) {
+		Attr::Builder.CreateCondBr(lhsV, rhsBB, endBB);
 	}
 
-	Value* lhsV = lhs->codegen();
-	Value* rhsV = rhs->codegen();
+	else {
+		Attr::Builder.CreateCondBr(lhsV, endBB, rhsBB);
+	}
+
+	Attr::Builder.SetInsertPoint(rhsBB);
+	auto rhsV = rhs->codegen();
+	if (not types::isBool(rhsV)) {
+		irGenAide::LogCodeGenError("The operator << " + Op + " >> only applies to booleans");
+	}
+
+	// the right side may have added blocks of its own, ex. for index checks
+	auto rhsEndBB = Attr::Builder.GetInsertBlock();
+	Attr::Builder.CreateBr(endBB);
+
+	Attr::Builder.SetInsertPoint(endBB);
+	auto resultV = Attr::Builder.CreatePHI(Attr::Builder.getInt1Ty(), 2);
+	resultV->addIncoming(Attr::Builder.getInt1(not isAnd), lhsBB);
+	resultV->addIncoming(rhsV, rhsEndBB);
+
+	return resultV;
+}
+
+
+// lhsV Op rhsV, for operands that are already evaluated
+static Value* emitBinaryOp(const std::string& Op, Value* lhsV, Value* rhsV) {
+	auto OpId = OpIds.at(Op);
 
 	if (types::isEnttyPtr(lhsV) or types::isEnttyPtr(rhsV)) {
 		if (types::isListePtr(lhsV) and types::isListePtr(rhsV)) {
@@ -155,15 +300,94 @@ Value* BinaryExpr::codegen() {
 			case 18:
 				return Attr::Builder.CreateICmpNE(lhsV, rhsV);
 
-			case 19:
+			default:
+				irGenAide::LogCodeGenError("Undefined binary operator << " + Op +
+				                           " >> between two booleans");
+		}
+	}
+
+	if (types::isEntier(lhsV) != types::isEntier(rhsV)) {
+		// an integral literal next to an entier is an entier, so i + 1 stays in integer arithmetic.
+		// Otherwise the entier is promoted to a reel
+		lhsV = irGenAide::coerceLiteral(lhsV, rhsV->getType());
+		rhsV = irGenAide::coerceLiteral(rhsV, lhsV->getType());
+
+		if (types::isEntier(lhsV) and types::isReel(rhsV)) {
+			lhsV = irGenAide::InttoDoubleCast(lhsV);
+		}
+
+		else if (types::isReel(lhsV) and types::isEntier(rhsV)) {
+			rhsV = irGenAide::InttoDoubleCast(rhsV);
+		}
+	}
+
+	if (types::isEntier(lhsV) and types::isEntier(rhsV)) {
+		switch (OpId) {
+			case 2:
+				return irGenAide::emitPow(lhsV, rhsV);
+
+			case 3:
+				return Attr::Builder.CreateMul(lhsV, rhsV);
+
+			case 4:
+				return emitIntDivision(false, lhsV, rhsV);
+
+			case 5:
+				return emitIntDivision(true, lhsV, rhsV);
+
+			case 6:
+				return Attr::Builder.CreateAdd(lhsV, rhsV);
+
+			case 7:
+				return Attr::Builder.CreateSub(lhsV, rhsV);
+
+			case 8:
+				return emitIntShift(true, lhsV, rhsV);
+
+			case 9:
+				return emitIntShift(false, lhsV, rhsV);
+
+			case 10:
 				return Attr::Builder.CreateAnd(lhsV, rhsV);
 
-			case 20:
+			case 11:
+				return Attr::Builder.CreateXor(lhsV, rhsV);
+
+			case 12:
 				return Attr::Builder.CreateOr(lhsV, rhsV);
 
+			case 13:
+				return Attr::Builder.CreateICmpSLT(lhsV, rhsV);
+
+			case 14:
+				return Attr::Builder.CreateICmpSGT(lhsV, rhsV);
+
+			case 15:
+				return Attr::Builder.CreateICmpSLE(lhsV, rhsV);
+
+			case 16:
+				return Attr::Builder.CreateICmpSGE(lhsV, rhsV);
+
+			case 17:
+				return Attr::Builder.CreateICmpEQ(lhsV, rhsV);
+
+			case 18:
+				return Attr::Builder.CreateICmpNE(lhsV, rhsV);
+
 			default:
 				irGenAide::LogCodeGenError("Undefined binary operator << " + Op +
-				                           " >> between two booleans");
+				                           " >> between two entiers");
+		}
+	}
+
+	if (types::isReel(lhsV) and types::isReel(rhsV) and isComparison(OpId)) {
+		// reels that hold a liste size or an integral variable are compared as integers. This also lets
+		// llvm see that an index bounded by a liste's size needs no bounds check.
+		auto lhsExactV = irGenAide::exactIntOf(lhsV);
+		auto rhsExactV = irGenAide::exactIntOf(rhsV);
+
+		if (lhsExactV and rhsExactV) {
+			return emitIntComparison(OpId, lhsExactV, rhsExactV);
 		}
 	}
 
@@ -173,17 +397,17 @@ Value* BinaryExpr::codegen() {
 
 		switch (OpId) {
 			case 2:
-				// call runtime exponent function
-				return Attr::Builder.CreateCall(irGenAide::getRtModuleFn("_kmath_puiss"),
-				                                { lhsV, rhsV });
+				return irGenAide::emitPow(lhsV, rhsV);
 
 			case 3:
 				return Attr::Builder.CreateFMul(lhsV, rhsV);
 
-			case 4:
+			case 4: {
 				// check division by zero
-				irGenAide::emitRtCheck("_kronk_zero_div_check", { rhsV });
+				auto nonZeroV = Attr::Builder.CreateFCmpUNE(rhsV, ConstantFP::get(rhsV->getType(), 0));
+				irGenAide::emitRtCheck(irGenAide::RtCheck::ZERO_DIVISION, nonZeroV);
 				return Attr::Builder.CreateFDiv(lhsV, rhsV);
+			}
 
 			case 5:
 				return Attr::Builder.CreateFRem(lhsV, rhsV);
@@ -195,10 +419,10 @@ Value* BinaryExpr::codegen() {
 				return Attr::Builder.CreateFSub(lhsV, rhsV);
 
 			case 8:
-				return irGenAide::InttoDoubleCast(Attr::Builder.CreateShl(lhsIntV, rhsIntV));
+				return irGenAide::InttoDoubleCast(emitIntShift(true, lhsIntV, rhsIntV));
 
 			case 9:
-				return irGenAide::InttoDoubleCast(Attr::Builder.CreateAShr(lhsIntV, rhsIntV));
+				return irGenAide::InttoDoubleCast(emitIntShift(false, lhsIntV, rhsIntV));
 
 			case 10:
 				return irGenAide::InttoDoubleCast(Attr::Builder.CreateAnd(lhsIntV, rhsIntV));
@@ -234,4 +458,77 @@ Value* BinaryExpr::codegen() {
 	}
 
 	irGenAide::LogCodeGenError("Incompatible operand types for the binary operator << " + Op + " >>");
-}
\ No newline at end of file
+}
+
+
+Value* BinaryExpr::codegen() {
+	auto OpId = OpIds.at(Op);
+
+	if (OpId == 21) {
+		auto assn = std::make_unique<Assignment>(std::move(lhs), std::move(rhs));
+		return assn->codegen();
+	}
+
+	if ((OpId == 19) or (OpId == 20)) {
+		return emitLogicalOp(Op, lhs.get(), rhs.get());
+	}
+
+	if (isComparison(OpId) and analysis::isIntegralExpr(lhs.get()) and
+	    analysis::isIntegralExpr(rhs.get())) {
+		// comparing integral variables, no need to go through reels
+		return emitIntComparison(OpId, analysis::emitIntegralExpr(lhs.get()),
+		                         analysis::emitIntegralExpr(rhs.get()));
+	}
+
+	Value* lhsV = lhs->codegen();
+	Value* rhsV = rhs->codegen();
+
+	return emitBinaryOp(Op, lhsV, rhsV);
+}
+
+
+Value* ChainedComparison::codegen() {
+	// a < b < c is a < b et b < c, where b is evaluated once. The operands after a failed comparison
+	// aren't evaluated at all.
+	bool isIntegral = std::all_of(operands.begin(), operands.end(),
+	                              [](auto& operand) { return analysis::isIntegralExpr(operand.get()); });
+
+	auto emitOperand = [isIntegral](Node* operand) {
+		return isIntegral ? analysis::emitIntegralExpr(operand) : operand->codegen();
+	};
+
+	auto currFunction = Attr::Builder.GetInsertBlock()->getParent();
+	auto endBB = BasicBlock::Create(Attr::Context, "chain.end");
+	std::vector<std::pair<Value*, BasicBlock*>> results;
+
+	auto lhsV = emitOperand(operands[0].get());
+
+	for (size_t i = 0; i < Ops.size(); i++) {
+		auto rhsV = emitOperand(operands[i + 1].get());
+		auto resultV = isIntegral ? emitIntComparison(OpIds.at(Ops[i]), lhsV, rhsV)
+		                          : emitBinaryOp(Ops[i], lhsV, rhsV);
+
+		if (i + 1 == Ops.size()) {
+			results.push_back({ resultV, Attr::Builder.GetInsertBlock() });
+			Attr::Builder.CreateBr(endBB);
+			break;
+		}
+
+		auto nextBB = BasicBlock::Create(Attr::Context, "chain.next", currFunction);
+		results.push_back({ Attr::Builder.getFalse(), Attr::Builder.GetInsertBlock() });
+		Attr::Builder.CreateCondBr(resultV, nextBB, endBB);
+
+		Attr::Builder.SetInsertPoint(nextBB);
+		lhsV = rhsV;
+	}
+
+	endBB->insertInto(currFunction);
+	Attr::Builder.SetInsertPoint(endBB);
+
+	auto resultV = Attr::Builder.CreatePHI(Attr::Builder.getInt1Ty(), results.size());
+	for (auto& [value, BB] : results) {
+		resultV->addIncoming(value, BB);
+	}
+
+	return resultV;
+}
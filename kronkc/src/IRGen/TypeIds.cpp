@@ -12,9 +12,12 @@ Type* BuiltinTyId::typegen() {
 		return Attr::Builder.getDoubleTy();
 	}
 
+	else if (builtinTypeId == "entier") {
+		return Attr::Builder.getInt64Ty();
+	}
+
 	else if (builtinTypeId == "str") {
-		return StructType::get(Attr::Context,
-		                       { Attr::Builder.getInt64Ty(), Attr::Builder.getInt8PtrTy() });
+		return types::getListeType(Attr::Builder.getInt8PtrTy());
 	}
 
 
@@ -29,13 +32,15 @@ Type* EntityTyId::typegen() { return names::EntityType(enttyTypeId).value(); }
 Type* ListTyId::typegen() {
 	auto lstElemTy = lstTypeId->typegen();
 	// The first element of a liste entity is the its size. The second is a POINTER TO ITS ELEMENT TYPE.
+	// The third is its capacity, i.e how many elements fit in its data block before it must grow. The
+	// fourth points to the reference count of the data block, if it is shared with other listes.
 
 	if (lstElemTy->isStructTy()) {
 		// the elements (entities) in this case are also pointers
-		// ex. liste(liste(nombre)) -> { i64, { i64, double* }** }, liste(Point) -> { i64, Point** }
-		return StructType::get(
-		    Attr::Context, { Attr::Builder.getInt64Ty(), lstElemTy->getPointerTo()->getPointerTo() });
+		// ex. liste(liste(nombre)) -> { i64, { i64, double*, i64, i64* }**, i64, i64* },
+		//     liste(Point) -> { i64, Point**, i64, i64* }
+		return types::getListeType(lstElemTy->getPointerTo()->getPointerTo());
 	}
-	// ex. liste(nombre) -> { i64, double* }
-	return StructType::get(Attr::Context, { Attr::Builder.getInt64Ty(), lstElemTy->getPointerTo() });
+	// ex. liste(nombre) -> { i64, double*, i64, i64* }
+	return types::getListeType(lstElemTy->getPointerTo());
 }
\ No newline at end of file
@@ -23,6 +23,11 @@ bool isReel(Type* ty) { return ty->isDoubleTy(); }
 bool isReel(Value* v) { return isReel(v->getType()); }
 
 
+bool isEntier(Type* ty) { return ty->isIntegerTy(64); }
+
+bool isEntier(Value* v) { return isEntier(v->getType()); }
+
+
 /// Checks if a given Type* points to a kronk entity. If it does it returns the pointerelementype
 StructType* isEnttyPtr(Type* type) {
 	if (type->isPointerTy()) {
@@ -63,6 +68,15 @@ bool isStringPtr(Type* ty) {
 bool isStringPtr(Value* v) { return isStringPtr(v->getType()); }
 
 
+/// Returns the type of a liste whose data block is pointed to by a dataPtrTy. A liste is its size, the
+/// pointer to its data block, the number of elements the data block can hold, and a pointer to the
+/// number of listes sharing the data block (null if it isn't shared)
+StructType* getListeType(Type* dataPtrTy) {
+	auto sizeTy = Attr::Builder.getInt64Ty();
+	return StructType::get(Attr::Context, { sizeTy, dataPtrTy, sizeTy, sizeTy->getPointerTo() });
+}
+
+
 std::string typestr(Type* ty) {
 	if (isBool(ty)) {
 		return "bool";
@@ -72,6 +86,10 @@ std::string typestr(Type* ty) {
 		return "reel";
 	}
 
+	if (isEntier(ty)) {
+		return "entier";
+	}
+
 	if (isStringPtr(ty)) {
 		return "str";
 	}
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
 #include "Attributes.h"
 #include "Driver.h"
+#include "Kronkaot.h"
 #include "Kronkjit.h"
 #include "argparse.h"
 
@@ -13,6 +18,92 @@ int main(int argc, char* argv[]) {
 	    .default_value(false)
 	    .implicit_value(true);
 
+	argparser.add_argument("-o")
+	    .help("compile the file ahead of time into the given output file instead of running it");
+
+	argparser.add_argument("--emit")
+	    .help("kind of output produced with -o: exe, obj, asm, ll or bc")
+	    .default_value(std::string("exe"));
+
+	argparser.add_argument("--cache-stats")
+	    .help("report the hits, misses, bytes saved and evictions of the on disk compile cache")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--alloc-stats")
+	    .help("report how many arena and heap allocations the program made when it ends")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--inline-runtime")
+	    .help("link the runtime into the program before optimizing so runtime checks can be inlined")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--sans-verifications")
+	    .help("leave out the index, slice and zero division checks. Only for trusted scripts")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--rapide-math")
+	    .help("let llvm reorder reel arithmetic to vectorize sums and use fmas. Results may vary a bit")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--sans-nan-inf")
+	    .help("with --rapide-math or in @rapide functions, assume reels are never nan or infinite")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--veclib")
+	    .help("vector math library that vectorized loops may call for sin, cos and exp: SVML or MASSV")
+	    .default_value(std::string(""));
+
+	argparser.add_argument("--export")
+	    .help("comma separated functions that stay visible outside the program, for -o with obj")
+	    .default_value(std::string(""));
+
+	for (auto level : { "-O0", "-O1", "-O2", "-O3", "-Os" }) {
+		argparser.add_argument(level)
+		    .help("optimization level. -O3 is the default, -O0 skips optimization for one shot scripts")
+		    .default_value(false)
+		    .implicit_value(true);
+	}
+
+	argparser.add_argument("--passes")
+	    .help("llvm pass pipeline to run instead of the one of the optimization level, ex. 'sroa,gvn'")
+	    .default_value(std::string(""));
+
+	argparser.add_argument("--time-passes")
+	    .help("report the time taken by each optimization pass")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--tiered")
+	    .help("start the program unoptimized and optimize its hot functions in the background. Has no "
+	          "effect with -O0, unless --passes gives the pipeline to optimize them with")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--lazy-optimize")
+	    .help("optimize each function when it is first called, instead of the whole program up front")
+	    .default_value(false)
+	    .implicit_value(true);
+
+	argparser.add_argument("--jit-threads")
+	    .help("number of threads the jit compiles on. Defaults to one per hardware thread")
+	    .default_value(std::max(1u, std::thread::hardware_concurrency()))
+	    .scan<'u', unsigned>();
+
+	argparser.add_argument("--jit-partition")
+	    .help("what the jit compiles when a function is first called: function, scc or module")
+	    .default_value(std::string("function"));
+
+	argparser.add_argument("--speculate")
+	    .help("compile the functions a function calls in the background as soon as it is compiled")
+	    .default_value(false)
+	    .implicit_value(true);
+
 	argparser.add_argument("inputFile");
 
 	try {
@@ -28,13 +119,82 @@ int main(int argc, char* argv[]) {
 
 	auto inputFile = argparser.get<std::string>("inputFile");
 
+	auto emitKind = Kronkaot::parseEmitKind(argparser.get<std::string>("--emit"));
+	if (not emitKind) {
+		std::cout << "Unknown output kind << " << argparser.get<std::string>("--emit") << " >>\n";
+		std::cout << argparser;
+		exit(EXIT_FAILURE);
+	}
+
+	auto vecLib = argparser.get<std::string>("--veclib");
+	if ((not vecLib.empty()) and (Attr::VecLibs.count(vecLib) == 0)) {
+		std::cout << "Unknown vector math library << " << vecLib << " >>\n";
+		std::cout << argparser;
+		exit(EXIT_FAILURE);
+	}
+
+	auto jitPartition = argparser.get<std::string>("--jit-partition");
+	if (Attr::JitPartitions.count(jitPartition) == 0) {
+		std::cout << "Unknown jit partitioning << " << jitPartition << " >>\n";
+		std::cout << argparser;
+		exit(EXIT_FAILURE);
+	}
+
+	auto jitThreads = argparser.get<unsigned>("--jit-threads");
+	if (jitThreads == 0) {
+		std::cout << "The jit needs at least one compile thread\n";
+		std::cout << argparser;
+		exit(EXIT_FAILURE);
+	}
+
 	Attr::PRINT_DEBUG_INFO = argparser.get<bool>("-d");
 	Attr::INCLUDE_MODE = false;
+	Attr::CACHE_STATS = argparser.get<bool>("--cache-stats");
+	Attr::ALLOC_STATS = argparser.get<bool>("--alloc-stats");
+	Attr::INLINE_RUNTIME = argparser.get<bool>("--inline-runtime");
+	Attr::SANS_VERIFICATIONS = argparser.get<bool>("--sans-verifications");
+	Attr::RAPIDE_MATH = argparser.get<bool>("--rapide-math");
+	Attr::SANS_NAN_INF = argparser.get<bool>("--sans-nan-inf");
+	Attr::VECLIB = vecLib;
+	Attr::PASSES = argparser.get<std::string>("--passes");
+	Attr::TIME_PASSES = argparser.get<bool>("--time-passes");
+
+	// the lowest level given wins
+	Attr::OPT_LEVEL = "O3";
+	for (auto level : { "-O3", "-O2", "-Os", "-O1", "-O0" }) {
+		if (argparser.get<bool>(level)) Attr::OPT_LEVEL = level + 1;
+	}
+
+	// ahead of time compiled programs can't be recompiled as they run, and at -O0 there's nothing to
+	// recompile the hot functions with
+	Attr::TIERED = argparser.get<bool>("--tiered") and (not argparser.present("-o")) and
+	               Kronkjit::hasPipeline();
+	Attr::LAZY_OPTIMIZE = argparser.get<bool>("--lazy-optimize") and (not argparser.present("-o")) and
+	                      (not Attr::TIERED);
+	Attr::JIT_THREADS = jitThreads;
+	Attr::JIT_PARTITION = jitPartition;
+	Attr::SPECULATE = argparser.get<bool>("--speculate");
+
+	std::stringstream exports(argparser.get<std::string>("--export"));
+	for (std::string name; std::getline(exports, name, ',');) {
+		if (not name.empty()) Attr::EXPORTS.insert(name);
+	}
 
 	auto driver = std::make_unique<CompileDriver>(std::move(inputFile));
 	driver->compileInputFile();
 
 	auto jit = std::make_unique<Kronkjit>();
 	jit->LinkAndOptimize();
+
+	if (auto outputFile = argparser.present("-o")) {
+		auto aot = std::make_unique<Kronkaot>(jit->takeMainModule());
+		aot->compile(*outputFile, *emitKind);
+
+		if (Attr::CACHE_STATS) jit->printCacheStats();
+		return 0;
+	}
+
 	jit->runOrcLazyJIT();
+
+	if (Attr::CACHE_STATS) jit->printCacheStats();
 }
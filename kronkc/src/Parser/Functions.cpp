@@ -65,10 +65,23 @@ std::unique_ptr<FunctionDefn> ParserImpl::ParseFunctionDefn() {
 
 	auto Proto = ParseFunctionPrototype();
 
+	// annotations come between the return type and the body
+	std::unordered_set<std::string> annotations;
+	while (isCurrTokenValue('@')) {
+		moveToNextToken();  // eat @
+		if (currentToken != Token::IDENTIFIER) LogError("Expected an annotation name after '@'");
+
+		auto annotation = ParseIdentifier();
+		if (Attr::FunctionAnnotations.count(annotation->name) == 0)
+			LogError("Unknown annotation << " + annotation->name + " >>");
+
+		annotations.insert(std::move(annotation->name));
+	}
+
 	if (not isCurrTokenValue('{')) LogError("Expected '{' ");
 
 	auto fnBody = ParseCompoundStmt();
-	return std::make_unique<FunctionDefn>(std::move(Proto), std::move(fnBody));
+	return std::make_unique<FunctionDefn>(std::move(Proto), std::move(fnBody), std::move(annotations));
 }
 
 
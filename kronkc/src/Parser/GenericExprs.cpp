@@ -48,22 +48,39 @@ std::unique_ptr<Node> ParserImpl::ParseBinOpRHS(int ExprPrec, std::unique_ptr<No
 		int NextTokPrec = getOpPrec();
 		if (TokPrec < NextTokPrec) {
 			RHS = ParseBinOpRHS(TokPrec + 1, std::move(RHS));
+
+			// the operator after that may bind as tightly as binOp, ex. ` 0 <= i + 1 < n ` is a chain
+			NextTokPrec = getOpPrec();
 		}
 
-		else if ((TokPrec == NextTokPrec)) {
+		if (TokPrec == NextTokPrec) {
 			if (isRightAssociativeOp(binOp)) {
 				RHS = ParseBinOpRHS(TokPrec, std::move(RHS));
 			}
 
 			if (isRelationalOp(binOp)) {
-				// this handles chained relational expressions by converting stuff like ` 2 == 2 == 3 `
-				// to ` (2 == 2) et (2 == 3) `
-				auto RHS_CLONE = RHS->clone();
+				// this handles chained relational expressions like ` a < f(x) < b `, which mean
+				// ` (a < f(x)) et (f(x) < b) ` but only evaluate f(x) once
+				auto chain = std::make_unique<ChainedComparison>(std::move(binOp), std::move(LHS),
+				                                                 std::move(RHS));
+
+				while (getOpPrec() == TokPrec) {
+					chain->Ops.push_back(lexer->IdentifierStr);
+					moveToNextToken();  // eat relational op
+
+					auto operand = ParseAtomicExpr();
+					if (currTokenIsAccessOp()) {
+						operand = ParseAccessOp(std::move(operand));
+					}
+
+					if (TokPrec < getOpPrec()) {
+						operand = ParseBinOpRHS(TokPrec + 1, std::move(operand));
+					}
 
-				LHS = std::make_unique<BinaryExpr>(std::move(binOp), std::move(LHS), std::move(RHS));
-				RHS = ParseBinOpRHS(TokPrec, std::move(RHS_CLONE));
+					chain->operands.push_back(std::move(operand));
+				}
 
-				LHS = std::make_unique<BinaryExpr>(std::string("et"), std::move(LHS), std::move(RHS));
+				LHS = std::move(chain);
 				continue;
 			}
 		}
@@ -4,6 +4,8 @@
 // Error Logging
 LLVM_ATTRIBUTE_NORETURN
 void ParserImpl::LogError(std::string errMsg) {
+	LogEarlierErrors();
+
 	outs() << "Parse Error in " << names::getModuleFile().filename() << '\n'
 	       << "[Line " << Attr::CurrentLexerLine << "]:  " << errMsg << '\n';
 
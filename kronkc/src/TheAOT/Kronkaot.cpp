@@ -0,0 +1,180 @@
+#include "Kronkaot.h"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetRegistry.h>
+
+#include "Kronkjit.h"
+
+
+LLVM_ATTRIBUTE_NORETURN
+void Kronkaot::aotError(std::string errMsg) {
+	outs() << "AOT Compile Error: " << errMsg << '\n';
+	exit(EXIT_FAILURE);
+}
+
+
+std::optional<EmitKind> Kronkaot::parseEmitKind(const std::string& kind) {
+	static const std::unordered_map<std::string, EmitKind> EmitKinds = { { "exe", EmitKind::EXECUTABLE },
+		                                                                 { "obj", EmitKind::OBJECT },
+		                                                                 { "asm", EmitKind::ASSEMBLY },
+		                                                                 { "ll", EmitKind::LLVM_IR },
+		                                                                 { "bc", EmitKind::BITCODE } };
+
+	if (auto it = EmitKinds.find(kind); it != EmitKinds.end()) {
+		return it->second;
+	}
+
+	return std::nullopt;
+}
+
+
+void Kronkaot::createTargetMachine() {
+	// we compile for the host, just like the jit does.
+	const auto& TT = MainModule->getTargetTriple();
+
+	std::string err;
+	auto target = TargetRegistry::lookupTarget(TT, err);
+	if (not target) {
+		aotError(err);
+	}
+
+	SubtargetFeatures features;
+	StringMap<bool> hostFeatures;
+	if (sys::getHostCPUFeatures(hostFeatures)) {
+		for (auto& feature : hostFeatures) {
+			features.AddFeature(feature.first(), feature.second);
+		}
+	}
+
+	TargetOptions options;
+	TM.reset(target->createTargetMachine(TT, sys::getHostCPUName(), features.getString(), options,
+	                                     Optional<Reloc::Model>(Reloc::PIC_), None,
+	                                     Kronkjit::getCodeGenOptLevel()));
+
+	MainModule->setDataLayout(TM->createDataLayout());
+}
+
+
+void Kronkaot::linkRuntime() {
+	// unlike the jit, which adds the runtime as a separate module, a native object must carry the
+	// runtime functions it calls. They may already have been linked in before optimization.
+
+	if (not Attr::Kronkrt) return;
+
+	if (auto err = Attr::Kronkrt->materializeAll()) {
+		aotError("Failed to load the kronk runtime: " + toString(std::move(err)));
+	}
+
+	if (Linker::linkModules(*MainModule.get(), std::move(Attr::Kronkrt))) {
+		aotError("Failed to link the kronk runtime into the program");
+	}
+}
+
+
+void Kronkaot::emitMachineCode(const fs::path& outputFile, CodeGenFileType fileType) {
+	std::error_code EC;
+	raw_fd_ostream dest(outputFile.string(), EC, sys::fs::OF_None);
+
+	if (EC) {
+		aotError("Could not open the file '" + outputFile.string() + "': " + EC.message());
+	}
+
+	legacy::PassManager codeGenPasses;
+	if (TM->addPassesToEmitFile(codeGenPasses, dest, nullptr, fileType)) {
+		aotError("The target machine can't emit a file of this type");
+	}
+
+	codeGenPasses.run(*MainModule.get());
+	dest.flush();
+}
+
+
+void Kronkaot::linkExecutable(const fs::path& objectFile, const fs::path& outputFile) {
+	// we leave the job of finding crt files and libc to the system's C compiler driver
+
+	std::string linker;
+	for (auto name : { "cc", "clang", "gcc" }) {
+		if (auto program = sys::findProgramByName(name)) {
+			linker = *program;
+			break;
+		}
+	}
+
+	if (linker.empty()) {
+		aotError("No C compiler driver found to link the executable, aborting..");
+	}
+
+	auto objectStr = objectFile.string();
+	auto outputStr = outputFile.string();
+	std::vector<StringRef> args = { linker, objectStr, "-o", outputStr, "-lm" };
+
+	// vectorized loops may call into the vector math library
+	std::string vecLibFlag;
+	if (not Attr::VECLIB.empty()) {
+		vecLibFlag = "-l" + Attr::VecLibs.at(Attr::VECLIB);
+		args.push_back(vecLibFlag);
+	}
+
+	std::string errMsg;
+	if (sys::ExecuteAndWait(linker, args, None, {}, 0, 0, &errMsg) != 0) {
+		aotError("Linking '" + outputStr + "' failed. " + errMsg);
+	}
+}
+
+
+void Kronkaot::compile(const fs::path& outputFile, EmitKind kind) {
+	LogProgress("Compiling ahead of time to " + outputFile.string());
+
+	if (kind == EmitKind::LLVM_IR or kind == EmitKind::BITCODE) {
+		// these are for inspection, so we leave out the runtime
+
+		std::error_code EC;
+		raw_fd_ostream dest(outputFile.string(), EC, sys::fs::OF_None);
+
+		if (EC) {
+			aotError("Could not open the file '" + outputFile.string() + "': " + EC.message());
+		}
+
+		if (kind == EmitKind::LLVM_IR) {
+			MainModule->print(dest, nullptr);
+		}
+
+		else {
+			WriteBitcodeToFile(*MainModule.get(), dest);
+		}
+
+		return;
+	}
+
+	linkRuntime();
+	createTargetMachine();
+
+	if (kind == EmitKind::ASSEMBLY) {
+		emitMachineCode(outputFile, CGFT_AssemblyFile);
+		return;
+	}
+
+	if (kind == EmitKind::OBJECT) {
+		emitMachineCode(outputFile, CGFT_ObjectFile);
+		return;
+	}
+
+	// the object file for the executable is temporary
+	SmallString<128> objectFile;
+	if (sys::fs::createTemporaryFile("kronk", "o", objectFile)) {
+		aotError("Could not create a temporary object file");
+	}
+
+	emitMachineCode(objectFile.str().str(), CGFT_ObjectFile);
+	linkExecutable(objectFile.str().str(), outputFile);
+
+	sys::fs::remove(objectFile);
+	LogProgress("Executable written to " + outputFile.string());
+}
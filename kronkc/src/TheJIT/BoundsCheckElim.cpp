@@ -0,0 +1,170 @@
+#include "BoundsCheckElim.h"
+
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/PatternMatch.h>
+
+using namespace llvm::PatternMatch;
+
+
+// the parts of a bounds check:  fixedIdx = (idx < 0) ? idx + size : idx,  br (fixedIdx u< size) ...
+struct IdxCheck {
+	BranchInst* branch;
+	Value* fixedIdx;
+	Value* idx;
+	Value* size;
+};
+
+
+static std::optional<IdxCheck> matchIdxCheck(BasicBlock& BB) {
+	auto branch = dyn_cast<BranchInst>(BB.getTerminator());
+	if ((not branch) or (not branch->isConditional()) or (not branch->getMetadata("kronk.idx.check"))) {
+		return std::nullopt;
+	}
+
+	ICmpInst::Predicate pred;
+	Value *fixedIdx, *size;
+	if (not match(branch->getCondition(), m_ICmp(pred, m_Value(fixedIdx), m_Value(size))) or
+	    (pred != ICmpInst::ICMP_ULT)) {
+		// the check was already folded
+		return std::nullopt;
+	}
+
+	// the fixup may also have been folded, for instance if the index is a constant
+	Value* idx = fixedIdx;
+	Value* selectIdx;
+	if (match(fixedIdx, m_Select(m_ICmp(pred, m_Value(selectIdx), m_Zero()), m_Value(),
+	                             m_Deferred(selectIdx))) and
+	    (pred == ICmpInst::ICMP_SLT)) {
+		idx = selectIdx;
+	}
+
+	return IdxCheck{ branch, fixedIdx, idx, size };
+}
+
+
+// Returns true if idx < size whenever BB runs. Either scalar evolution can tell on its own, or BB only
+// runs after a comparison of idx against size (or against something no larger than size) came out true,
+// as in the body of   Tantque(i < lst.size) { ... lst[i] ... }
+static bool isBoundedBy(Value* idx, Value* size, BasicBlock& BB, ScalarEvolution& SE, DominatorTree& DT) {
+	auto idxS = SE.getSCEV(idx);
+	auto sizeS = SE.getSCEV(size);
+
+	if (SE.isKnownPredicate(ICmpInst::ICMP_SLT, idxS, sizeS)) {
+		return true;
+	}
+
+	auto node = DT.getNode(&BB);
+	if (not node) return false;
+
+	for (node = node->getIDom(); node; node = node->getIDom()) {
+		auto guardBB = node->getBlock();
+		auto guard = dyn_cast<BranchInst>(guardBB->getTerminator());
+
+		ICmpInst::Predicate pred;
+		Value *lhs, *rhs;
+		if ((not guard) or (not guard->isConditional()) or
+		    (not match(guard->getCondition(), m_ICmp(pred, m_Value(lhs), m_Value(rhs))))) {
+			continue;
+		}
+
+		// the comparison holds in BB if BB can only be reached through the true edge of the guard, and
+		// its inverse holds if BB can only be reached through the false edge.
+		if (not DT.dominates(BasicBlockEdge(guardBB, guard->getSuccessor(0)), &BB)) {
+			if (not DT.dominates(BasicBlockEdge(guardBB, guard->getSuccessor(1)), &BB)) continue;
+			pred = CmpInst::getInversePredicate(pred);
+		}
+
+		if (ICmpInst::isGT(pred) or ICmpInst::isGE(pred)) {
+			std::swap(lhs, rhs);
+			pred = CmpInst::getSwappedPredicate(pred);
+		}
+
+		if (SE.getSCEV(lhs) != idxS) continue;
+
+		auto rhsS = SE.getSCEV(rhs);
+
+		switch (pred) {
+			case ICmpInst::ICMP_SLT:
+				if (SE.isKnownPredicate(ICmpInst::ICMP_SLE, rhsS, sizeS)) return true;
+				break;
+
+			case ICmpInst::ICMP_SLE:
+				if (SE.isKnownPredicate(ICmpInst::ICMP_SLT, rhsS, sizeS)) return true;
+				break;
+
+			case ICmpInst::ICMP_ULT:
+				if (rhsS == sizeS) return true;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return false;
+}
+
+
+PreservedAnalyses BoundsCheckElimPass::run(Function& F, FunctionAnalysisManager& FAM) {
+	auto& SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+	auto& DT = FAM.getResult<DominatorTreeAnalysis>(F);
+	auto& LI = FAM.getResult<LoopAnalysis>(F);
+	auto& DL = F.getParent()->getDataLayout();
+
+	bool changed = false;
+
+	for (auto& BB : F) {
+		auto check = matchIdxCheck(BB);
+		if (not check) continue;
+
+		auto idxS = SE.getSCEV(check->idx);
+		auto sizeS = SE.getSCEV(check->size);
+
+		bool isNonNegative = SE.isKnownNonNegative(idxS) or
+		                     isKnownNonNegative(check->idx, DL, 0, nullptr, check->branch, &DT);
+
+		if (isNonNegative and (check->fixedIdx != check->idx)) {
+			// the index is never counted from the end of the liste
+			check->fixedIdx->replaceAllUsesWith(check->idx);
+			changed = true;
+		}
+
+		bool isInBounds = false;
+
+		if (isNonNegative) {
+			isInBounds = isBoundedBy(check->idx, check->size, BB, SE, DT);
+		}
+
+		else if (SE.isKnownNegative(idxS)) {
+			// ex. lst[-1] in a liste that is known to have at least one element
+			isInBounds = SE.isKnownPredicate(ICmpInst::ICMP_SLE, SE.getNegativeSCEV(idxS), sizeS);
+		}
+
+		if (isInBounds) {
+			check->branch->setCondition(ConstantInt::getTrue(F.getContext()));
+			changed = true;
+			continue;
+		}
+
+		// a check whose outcome doesn't change from one iteration to the next is computed once before
+		// the loop. If nothing with side effects comes before it in the loop, llvm's loop unswitching
+		// then moves the branch out of the loop too.
+		if (auto L = LI.getLoopFor(&BB)) {
+			bool hoisted = false;
+			L->makeLoopInvariant(check->branch->getCondition(), hoisted);
+			changed |= hoisted;
+		}
+	}
+
+	if (not changed) {
+		return PreservedAnalyses::all();
+	}
+
+	// the cfg is the same, only branch conditions changed. SimplifyCFG removes the dead error blocks.
+	PreservedAnalyses PA;
+	PA.preserveSet<CFGAnalyses>();
+	return PA;
+}
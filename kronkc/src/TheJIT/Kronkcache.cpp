@@ -0,0 +1,223 @@
+#include "Kronkcache.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+
+
+Kronkcache::Kronkcache(std::string&& targetId) : targetId(std::move(targetId)) {
+	SmallString<128> userCacheDir;
+	if (sys::path::cache_directory(userCacheDir)) {
+		cacheDir = fs::path(userCacheDir.str().str()) / "kronk";
+	}
+
+	else {
+		cacheDir = fs::temp_directory_path() / "kronk";
+	}
+
+	std::error_code EC;
+	fs::create_directories(cacheDir, EC);
+}
+
+
+std::string Kronkcache::hashModule(const Module& M) {
+	std::string ir;
+	raw_string_ostream irStream(ir);
+	M.print(irStream, nullptr);
+	irStream.flush();
+
+	SHA1 hasher;
+	hasher.update(targetId);
+	hasher.update(ir);
+
+	return toHex(hasher.final(), true);
+}
+
+
+// key of the optimized whole program module. M is the linked but not yet optimized module.
+std::string Kronkcache::moduleKey(const Module& M) { return hashModule(M) + ".bc"; }
+
+
+// key of the object compiled from M, which is one of the partitions the lazy jit hands to its compile
+// layer. The key computed on a cache miss is remembered until the compiled object is stored. It is then
+// forgotten since the partition is freed afterwards and another one may take its address.
+std::string Kronkcache::objectKey(const Module* M, bool forget) {
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		auto it = objectKeys.find(M);
+		if (it != objectKeys.end()) {
+			auto key = it->second;
+			if (forget) objectKeys.erase(it);
+
+			return key;
+		}
+	}
+
+	auto key = hashModule(*M) + ".o";
+
+	if (not forget) {
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		objectKeys[M] = key;
+	}
+
+	return key;
+}
+
+
+// With --lazy-optimize, the partitions are optimized as the jit materializes them. Their key is taken
+// here, before the optimization, so the partitions whose object is already cached can skip it. Returns
+// whether that is the case.
+bool Kronkcache::keyUnoptimizedPartition(const Module& M) {
+	auto key = hashModule(M) + ".o";
+	bool isCached = fs::exists(cacheDir / key);
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	objectKeys[&M] = key;
+
+	return isCached;
+}
+
+
+void Kronkcache::writeEntry(const fs::path& entry, StringRef data) {
+	// write to a unique temporary file first then rename it, so concurrent runs never see a partially
+	// written entry
+
+	int fd;
+	SmallString<128> tmpPath;
+	if (sys::fs::createUniqueFile(entry.string() + "-%%%%%%.tmp", fd, tmpPath)) {
+		return;
+	}
+
+	{
+		raw_fd_ostream tmpStream(fd, /* shouldClose */ true);
+		tmpStream << data;
+	}
+
+	if (sys::fs::rename(tmpPath, entry.string())) {
+		sys::fs::remove(tmpPath);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	if (not cacheSize) {
+		evictEntries();
+	}
+
+	else {
+		*cacheSize += data.size();
+		if (*cacheSize > MaxCacheSize) evictEntries();
+	}
+}
+
+
+// Entries are used again the next time the same script runs. Their modification time is the time of
+// their last use, which evictEntries goes by.
+void Kronkcache::touchEntry(const fs::path& entry) {
+	std::error_code EC;
+	fs::last_write_time(entry, fs::file_time_type::clock::now(), EC);
+}
+
+
+// Recomputes the size of the entries and removes the least recently used ones until they fit in
+// MaxCacheSize. Must be called with cacheMutex held.
+void Kronkcache::evictEntries() {
+	std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+	uintmax_t size = 0;
+
+	std::error_code EC;
+	for (auto& file : fs::directory_iterator(cacheDir, EC)) {
+		// the temporary files of the runs writing an entry right now are left alone
+		if ((not file.is_regular_file(EC)) or (file.path().extension() == ".tmp")) continue;
+
+		size += file.file_size(EC);
+		entries.push_back({ file.last_write_time(EC), file.path() });
+	}
+
+	if (size > MaxCacheSize) {
+		std::sort(entries.begin(), entries.end());
+
+		for (auto& [mtime, path] : entries) {
+			if (size <= MaxCacheSize) break;
+
+			auto entrySize = fs::file_size(path, EC);
+			if (EC or (not fs::remove(path, EC))) continue;
+
+			size -= entrySize;
+			evictions++;
+		}
+	}
+
+	cacheSize = size;
+}
+
+
+std::unique_ptr<Module> Kronkcache::getOptimizedModule(const std::string& key) {
+	auto buffer = MemoryBuffer::getFile((cacheDir / key).string());
+	if (not buffer) {
+		return nullptr;
+	}
+
+	touchEntry(cacheDir / key);
+
+	auto M = parseBitcodeFile((*buffer)->getMemBufferRef(), Attr::Context);
+	if (not M) {
+		consumeError(M.takeError());
+		return nullptr;
+	}
+
+	moduleHit = true;
+	return std::move(*M);
+}
+
+
+void Kronkcache::storeOptimizedModule(const std::string& key, const Module& M) {
+	std::string bitcode;
+	raw_string_ostream bitcodeStream(bitcode);
+	WriteBitcodeToFile(M, bitcodeStream);
+	bitcodeStream.flush();
+
+	writeEntry(cacheDir / key, bitcode);
+}
+
+
+void Kronkcache::notifyObjectCompiled(const Module* M, MemoryBufferRef Obj) {
+	auto key = objectKey(M, true);
+	writeEntry(cacheDir / key, Obj.getBuffer());
+}
+
+
+std::unique_ptr<MemoryBuffer> Kronkcache::getObject(const Module* M) {
+	auto key = objectKey(M, false);
+	auto buffer = MemoryBuffer::getFile((cacheDir / key).string());
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	if (not buffer) {
+		// M is about to be compiled, notifyObjectCompiled will need the key.
+		objectMisses++;
+		return nullptr;
+	}
+
+	objectKeys.erase(M);
+	touchEntry(cacheDir / key);
+
+	objectHits++;
+	bytesSaved += (*buffer)->getBufferSize();
+
+	return std::move(*buffer);
+}
+
+
+void Kronkcache::printStats() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	outs() << "[ Cache Stats ]: optimized module " << (moduleHit ? "hit" : "miss") << ", objects: "
+	       << objectHits << " hits, " << objectMisses << " misses, " << bytesSaved << " bytes saved, "
+	       << evictions << " entries evicted" << '\n';
+}
@@ -1,34 +1,266 @@
 #include "Kronkjit.h"
 
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/PassTimingInfo.h>
 #include <llvm/Linker/Linker.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Transforms/IPO/FunctionAttrs.h>
+#include <llvm/Transforms/IPO/GlobalDCE.h>
+#include <llvm/Transforms/IPO/InferFunctionAttrs.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar/EarlyCSE.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Scalar/IndVarSimplify.h>
+#include <llvm/Transforms/Scalar/LICM.h>
+#include <llvm/Transforms/Scalar/LoopPassManager.h>
+#include <llvm/Transforms/Scalar/LowerExpectIntrinsic.h>
+#include <llvm/Transforms/Scalar/SROA.h>
+#include <llvm/Transforms/Scalar/SimplifyCFG.h>
+#include <llvm/Transforms/Utils/LoopSimplify.h>
+
+#include "BoundsCheckElim.h"
+#include "Kronktier.h"
 
 #include <llvm/CodeGen/CommandFlags.inc>
 
 
 static ExitOnError ExitOnErr("FATAL ERROR");
 
-void Kronkjit::LinkAndOptimize() {
-	// first link
 
-	auto linker = std::make_unique<Linker>(*MainModule.get());
+LLVM_ATTRIBUTE_NORETURN
+void Kronkjit::jitError(std::string errMsg) {
+	outs() << "FATAL ERROR: " << errMsg << '\n';
+	exit(EXIT_FAILURE);
+}
 
-	for (auto& [_, kModule] : Attr::ModuleMap) {
-		// skip those fake modules that we used to refer to modules in the kronk runtime.
-		if (kModule->rtModule.empty()) {
-			linker->linkInModule(std::move(kModule->TheModule));
+
+// identifies what the cached modules and objects were compiled for and by.
+static std::string getCacheTargetId() {
+	return sys::getDefaultTargetTriple() + "-" + getCPUStr() + "-" + getFeaturesStr() +
+	       "-kronkc" KRONKC_VERSION "-llvm" LLVM_VERSION_STRING + "-" + Attr::VECLIB + "-" +
+	       Attr::OPT_LEVEL + "-" + Attr::PASSES + (Attr::LAZY_OPTIMIZE ? "-lazy" : "");
+}
+
+
+// how hard the backend works on the optimized ir, see -O
+CodeGenOpt::Level Kronkjit::getCodeGenOptLevel() {
+	static const std::unordered_map<std::string, CodeGenOpt::Level> CodeGenOptLevels = {
+		{ "O0", CodeGenOpt::None },
+		{ "O1", CodeGenOpt::Less },
+		{ "O2", CodeGenOpt::Default },
+		{ "Os", CodeGenOpt::Default },
+		{ "O3", CodeGenOpt::Aggressive }
+	};
+
+	return CodeGenOptLevels.at(Attr::OPT_LEVEL);
+}
+
+
+// -O0 has no default pipeline, so unless --passes gives one the ir is left as irgen made it
+bool Kronkjit::hasPipeline() {
+	return (Attr::OPT_LEVEL != "O0") or (not Attr::PASSES.empty());
+}
+
+
+// the default pipeline of the optimization level, see hasPipeline for -O0
+static PassBuilder::OptimizationLevel getOptLevel() {
+	static const std::unordered_map<std::string, PassBuilder::OptimizationLevel> OptLevels = {
+		{ "O1", PassBuilder::OptimizationLevel::O1 },
+		{ "O2", PassBuilder::OptimizationLevel::O2 },
+		{ "Os", PassBuilder::OptimizationLevel::Os },
+		{ "O3", PassBuilder::OptimizationLevel::O3 }
+	};
+
+	return OptLevels.at(Attr::OPT_LEVEL);
+}
+
+
+// describes the machine the program is optimized and compiled for
+orc::JITTargetMachineBuilder Kronkjit::getJITTargetMachineBuilder(const std::string& TT) {
+	orc::JITTargetMachineBuilder JTMB((Triple(TT)));
+
+	if (not MArch.empty()) {
+		JTMB.getTargetTriple().setArchName(MArch);
+	}
+
+	JTMB.setCPU(getCPUStr())
+	    .addFeatures(getFeatureList())
+	    .setCodeGenOptLevel(Kronkjit::getCodeGenOptLevel())
+	    .setRelocationModel(RelocModel.getNumOccurrences() ? Optional<Reloc::Model>(RelocModel) : None)
+	    .setCodeModel(CMModel.getNumOccurrences() ? Optional<CodeModel::Model>(CMModel) : None);
+
+	return JTMB;
+}
+
+
+// The vector math library (see --veclib) whose functions the loop vectorizer may call in place of
+// the scalar sin, cos... It has to be loaded for the jitted code to find them.
+static TargetLibraryInfoImpl::VectorLibrary getVecLib() {
+	if (Attr::VECLIB.empty()) {
+		return TargetLibraryInfoImpl::NoLibrary;
+	}
+
+	auto libFile = "lib" + Attr::VecLibs.at(Attr::VECLIB) + ".so";
+	if (sys::DynamicLibrary::LoadLibraryPermanently(libFile.c_str())) {
+		LogProgress("Could not load the vector math library " + libFile);
+	}
+
+	return (Attr::VECLIB == "SVML") ? TargetLibraryInfoImpl::SVML : TargetLibraryInfoImpl::MASSV;
+}
+
+
+void Kronkjit::linkRuntime(Linker& linker) {
+	// Links the runtime functions referenced by the program (and whatever they call) into MainModule,
+	// so the optimizer sees through runtime functions like _kronk_list_append instead of treating them
+	// as opaque external calls. The linked functions are made internal so they can be inlined and then
+	// dropped.
+
+	LogProgress("Linking the referenced runtime functions into the program");
+
+	ExitOnErr(Attr::Kronkrt->materializeAll());
+
+	auto internalizeLinked = [](Module& M, const StringSet<>& linkedSymbols) {
+		for (auto& symbol : linkedSymbols) {
+			if (auto fn = M.getFunction(symbol.first())) {
+				fn->removeFnAttr(Attribute::OptimizeNone);
+				fn->removeFnAttr(Attribute::NoInline);
+			}
+		}
+
+		internalizeModule(M, [&linkedSymbols](const GlobalValue& GV) {
+			return not GV.hasName() or (linkedSymbols.count(GV.getName()) == 0);
+		});
+	};
+
+	if (linker.linkInModule(std::move(Attr::Kronkrt), Linker::Flags::LinkOnlyNeeded, internalizeLinked)) {
+		jitError("Failed to link the kronk runtime into the program");
+	}
+}
+
+
+// The passes that clean up the ir enough for the bounds checks of liste indexing to be proven (the
+// liste sizes and indices must be ssa values, and loop counters must be known not to wrap) followed by
+// the bounds check elimination itself. They run before the default pipeline so that it optimizes
+// loops without the checks that were removed.
+static FunctionPassManager buildBoundsCheckElimPipeline() {
+	FunctionPassManager passManager;
+
+	// the conditions of the runtime checks go through llvm.expect, which would hide them from the
+	// bounds check elimination
+	passManager.addPass(LowerExpectIntrinsicPass());
+	passManager.addPass(SROA());
+	passManager.addPass(EarlyCSEPass(/* UseMemorySSA */ true));
+	passManager.addPass(InstCombinePass());
+	passManager.addPass(SimplifyCFGPass());
+	passManager.addPass(LoopSimplifyPass());
+	passManager.addPass(createFunctionToLoopPassAdaptor(LICMPass(), /* UseMemorySSA */ true));
+	passManager.addPass(createFunctionToLoopPassAdaptor(IndVarSimplifyPass()));
+	passManager.addPass(GVN());
+
+	passManager.addPass(BoundsCheckElimPass());
+	passManager.addPass(SimplifyCFGPass());
+
+	return passManager;
+}
+
+
+// Defines the table of source file names that the runtime checks refer to by index (see
+// irGenAide::emitRtCheck). It only holds the files of the program, so it is emitted once they are all
+// linked together.
+static void emitSourceFileTable(Module& M) {
+	std::vector<Constant*> fileNames;
+	for (auto& file : Attr::SourceFiles) {
+		auto nameV = ConstantDataArray::getString(Attr::Context, file);
+		auto nameGV = new GlobalVariable(M, nameV->getType(), true, GlobalValue::PrivateLinkage, nameV);
+		fileNames.push_back(ConstantExpr::getPointerCast(nameGV, Attr::Builder.getInt8PtrTy()));
+	}
+
+	auto tableTy = ArrayType::get(Attr::Builder.getInt8PtrTy(), fileNames.size());
+	auto tableV = ConstantArray::get(tableTy, fileNames);
+	new GlobalVariable(M, tableTy, true, GlobalValue::ExternalLinkage, tableV, "_kronk_source_files");
+}
+
+
+// Whether GV must stay visible outside the program: main, the table of source files that the runtime
+// reads, and the functions named with --export. Function names are mangled (see
+// names::mangleNameAsLocalFunction), so they end with the length of the kronk name followed by the name.
+static bool isEntryPoint(const GlobalValue& GV) {
+	auto name = GV.getName();
+	if ((name == "main") or (name == "_kronk_source_files")) {
+		return true;
+	}
+
+	return isa<Function>(GV) and name.startswith("_Z") and
+	       std::any_of(Attr::EXPORTS.begin(), Attr::EXPORTS.end(), [&name](const std::string& exported) {
+		       return name.endswith(std::to_string(exported.size()) + exported);
+	       });
+}
+
+
+// reports the size of the program before and after optimization
+static void logProgramSize(const Module& M, const std::string& when) {
+	size_t numFunctions = 0, numInstructions = 0, numCalls = 0;
+	for (auto& fn : M) {
+		if (fn.isDeclaration()) continue;
+
+		numFunctions++;
+		for (auto& BB : fn) {
+			for (auto& inst : BB) {
+				numInstructions++;
+				if (isa<CallBase>(inst) and (not isa<IntrinsicInst>(inst))) numCalls++;
+			}
 		}
 	}
 
-	// then optimze
+	LogProgress(when + ": " + std::to_string(numFunctions) + " functions, " +
+	            std::to_string(numInstructions) + " instructions, " +
+	            std::to_string(numCalls) + " calls");
+}
+
+
+// the pipeline of the optimization level, along with the passes kronk runs before it
+static void addDefaultPipeline(PassBuilder& passBuilder, ModulePassManager& modulePassManager) {
+	// infer readnone, nounwind, norecurse.. bottom up the call graph before anything else, so the bounds
+	// check elimination and the inliner already know which calls don't touch memory
+	modulePassManager.addPass(InferFunctionAttrsPass());
+	modulePassManager.addPass(createModuleToPostOrderCGSCCPassAdaptor(PostOrderFunctionAttrsPass()));
+	modulePassManager.addPass(ReversePostOrderFunctionAttrsPass());
+	modulePassManager.addPass(GlobalDCEPass());
+
+	if (not Attr::SANS_VERIFICATIONS) {
+		modulePassManager.addPass(createModuleToFunctionPassAdaptor(buildBoundsCheckElimPipeline()));
+	}
+
+	modulePassManager.addPass(passBuilder.buildPerModuleDefaultPipeline(getOptLevel()));
+}
+
+
+// Runs the pipeline of the optimization level, or the one given with --passes, over M. TM is the machine
+// M is optimized for.
+void Kronkjit::optimizeModule(Module& M, TargetMachine* TM) {
+	// with --time-passes, the time taken by each pass is reported once the pipeline is done
+	PassInstrumentationCallbacks instrumentation;
+	TimePassesHandler passTimes(Attr::TIME_PASSES);
+	passTimes.registerCallbacks(instrumentation);
 
-	llvm::PassBuilder passBuilder;
+	llvm::PassBuilder passBuilder(TM, PipelineTuningOptions(), None, &instrumentation);
 	llvm::LoopAnalysisManager loopAnalysisManager;  // true is just to output debug info
 	llvm::FunctionAnalysisManager functionAnalysisManager;
 	llvm::CGSCCAnalysisManager cGSCCAnalysisManager;
 	llvm::ModuleAnalysisManager moduleAnalysisManager;
 
+	// registered before the default analyses so it takes their place
+	TargetLibraryInfoImpl targetLibraryInfo(Triple(M.getTargetTriple()));
+	targetLibraryInfo.addVectorizableFunctionsFromVecLib(getVecLib());
+	functionAnalysisManager.registerPass([&] { return TargetLibraryAnalysis(targetLibraryInfo); });
+
 	passBuilder.registerModuleAnalyses(moduleAnalysisManager);
 	passBuilder.registerCGSCCAnalyses(cGSCCAnalysisManager);
 	passBuilder.registerFunctionAnalyses(functionAnalysisManager);
@@ -37,14 +269,145 @@ void Kronkjit::LinkAndOptimize() {
 	passBuilder.crossRegisterProxies(loopAnalysisManager, functionAnalysisManager, cGSCCAnalysisManager,
 	                                 moduleAnalysisManager);
 
-	llvm::ModulePassManager modulePassManager =
-	    passBuilder.buildPerModuleDefaultPipeline(llvm::PassBuilder::OptimizationLevel::O3);
-	modulePassManager.run(*MainModule.get(), moduleAnalysisManager);
+	// lets --passes pipelines use the bounds check elimination, ex. 'function(kronk-bce),default<O2>'
+	passBuilder.registerPipelineParsingCallback(
+	    [](StringRef name, FunctionPassManager& passManager, ArrayRef<PassBuilder::PipelineElement>) {
+		    if (name != "kronk-bce") return false;
+
+		    passManager.addPass(buildBoundsCheckElimPipeline());
+		    return true;
+	    });
+
+	llvm::ModulePassManager modulePassManager;
+
+	if (not Attr::PASSES.empty()) {
+		if (auto err = passBuilder.parsePassPipeline(modulePassManager, Attr::PASSES)) {
+			jitError("Invalid pass pipeline << " + Attr::PASSES + " >>: " + toString(std::move(err)));
+		}
+	}
+
+	else {
+		addDefaultPipeline(passBuilder, modulePassManager);
+	}
+
+	modulePassManager.run(M, moduleAnalysisManager);
+}
+
+
+void Kronkjit::LinkAndOptimize() {
+	Cache = std::make_unique<Kronkcache>(getCacheTargetId());
+
+	// first link
+
+	auto linker = std::make_unique<Linker>(*MainModule.get());
+
+	for (auto& [_, kModule] : Attr::ModuleMap) {
+		// skip those fake modules that we used to refer to modules in the kronk runtime.
+		if (kModule->rtModule.empty()) {
+			linker->linkInModule(std::move(kModule->TheModule));
+		}
+	}
+
+	emitSourceFileTable(*MainModule.get());
+
+	if (Attr::INLINE_RUNTIME) {
+		linkRuntime(*linker.get());
+	}
+
+	// nothing outside the program calls its functions, so the optimizer can inline them, change their
+	// signatures or drop them once inlined
+	internalizeModule(*MainModule.get(), [](const GlobalValue& GV) { return isEntryPoint(GV); });
+
+	// the optimizer needs the target's vector width and instruction costs to vectorize loops
+	auto TM = ExitOnErr(getJITTargetMachineBuilder(MainModule->getTargetTriple()).createTargetMachine());
+	MainModule->setDataLayout(TM->createDataLayout());
+
+	// -O0 runs the program as irgen left it, which is the quickest way to start a one shot script. With
+	// --tiered, the hot functions are optimized later on, one by one, and with --lazy-optimize each
+	// function is optimized when the jit first needs it (see runOrcLazyJIT).
+	if ((not hasPipeline()) or Attr::TIERED or Attr::LAZY_OPTIMIZE) {
+		return;
+	}
+
+	// then optimze, unless this exact program was already optimized in a previous run
+
+	auto moduleKey = Cache->moduleKey(*MainModule.get());
+	if (auto CachedModule = Cache->getOptimizedModule(moduleKey)) {
+		LogProgress("Reusing optimized module from the cache");
+		MainModule = std::move(CachedModule);
+		return;
+	}
+
+	logProgramSize(*MainModule.get(), "Before optimization");
+	optimizeModule(*MainModule.get(), TM.get());
+	logProgramSize(*MainModule.get(), "After optimization");
+
+	Cache->storeOptimizedModule(moduleKey, *MainModule.get());
 
 	// MainModule->print(llvm::errs(), nullptr);
 }
 
 
+// With --jit-partition scc, a function is compiled along with the other functions of its call graph scc.
+// With --lazy-optimize, they can then be inlined into each other.
+static orc::CompileOnDemandLayer::PartitionFunction getSCCPartitioner(Module& M) {
+	std::unordered_map<const GlobalValue*, std::vector<const GlobalValue*>> sccs;
+
+	CallGraph callGraph(M);
+	for (auto it = scc_begin(&callGraph); not it.isAtEnd(); ++it) {
+		std::vector<const GlobalValue*> scc;
+		for (auto node : *it) {
+			auto fn = node->getFunction();
+			if (fn and (not fn->isDeclaration())) scc.push_back(fn);
+		}
+
+		for (auto fn : scc) sccs[fn] = scc;
+	}
+
+	return [sccs = std::move(sccs)](orc::CompileOnDemandLayer::GlobalValueSet requested) {
+		auto partition = requested;
+		for (auto GV : requested) {
+			if (auto it = sccs.find(GV); it != sccs.end()) {
+				partition.insert(it->second.begin(), it->second.end());
+			}
+		}
+
+		return Optional<orc::CompileOnDemandLayer::GlobalValueSet>(std::move(partition));
+	};
+}
+
+
+// With --speculate, the functions that M calls start compiling on the compile threads as soon as M is
+// compiled, since M is about to run. They are usually ready by the time they are called. The function
+// bodies live in the implementation dylib of the lazy jit, the main dylib only holds the stubs that
+// compile them on their first call.
+static void speculateCallees(orc::LLLazyJIT& J, const Module& M) {
+	auto& ES = J.getExecutionSession();
+	auto implDylib = ES.getJITDylibByName(J.getMainJITDylib().getName() + ".impl");
+	if (not implDylib) return;
+
+	// the functions of other partitions are declared in M. Those of the runtime and libc aren't in the
+	// implementation dylib, so they are only weakly looked up.
+	orc::MangleAndInterner Mangle(ES, J.getDataLayout());
+	orc::SymbolLookupSet callees;
+	for (auto& fn : M) {
+		if (fn.isDeclaration() and (not fn.isIntrinsic()) and (not fn.use_empty())) {
+			callees.add(Mangle(fn.getName()), orc::SymbolLookupFlags::WeaklyReferencedSymbol);
+		}
+	}
+
+	if (callees.empty()) return;
+
+	// nothing waits for the lookup, it only triggers the compilation
+	ES.lookup(orc::LookupKind::Static, orc::makeJITDylibSearchOrder(implDylib), std::move(callees),
+	          orc::SymbolState::Ready,
+	          [](Expected<orc::SymbolMap> result) {
+		          if (not result) consumeError(result.takeError());
+	          },
+	          orc::NoDependenciesToRegister);
+}
+
+
 LLVM_ATTRIBUTE_NORETURN
 static void jitCompileFailure() {
 	outs() << "FATAL ERROR.." << '\n';
@@ -65,20 +428,22 @@ int Kronkjit::runOrcLazyJIT() {
 
 	orc::LLLazyJITBuilder Builder;
 
-	Builder.setJITTargetMachineBuilder(orc::JITTargetMachineBuilder(Triple(TT)));
-
-	if (not MArch.empty()) {
-		Builder.getJITTargetMachineBuilder()->getTargetTriple().setArchName(MArch);
+	// tier 0 code is compiled as fast as possible, with the fast instruction selector
+	auto JTMB = getJITTargetMachineBuilder(TT);
+	if (Attr::TIERED) {
+		JTMB.setCodeGenOptLevel(CodeGenOpt::None);
 	}
 
-	Builder.getJITTargetMachineBuilder()
-	    ->setCPU(getCPUStr())
-	    .addFeatures(getFeatureList())
-	    .setRelocationModel(RelocModel.getNumOccurrences() ? Optional<Reloc::Model>(RelocModel) : None)
-	    .setCodeModel(CMModel.getNumOccurrences() ? Optional<CodeModel::Model>(CMModel) : None);
+	Builder.setJITTargetMachineBuilder(std::move(JTMB));
 
 	Builder.setLazyCompileFailureAddr(pointerToJITTargetAddress(jitCompileFailure));
-	Builder.setNumCompileThreads(2);
+	Builder.setNumCompileThreads(Attr::JIT_THREADS);
+
+	// compiled objects go through the on disk cache
+	Builder.setCompileFunctionCreator(
+	    [this](orc::JITTargetMachineBuilder JTMB) -> Expected<orc::IRCompileLayer::CompileFunction> {
+		    return orc::ConcurrentIRCompiler(std::move(JTMB), Cache.get());
+	    });
 
 	auto J = ExitOnErr(Builder.create());
 
@@ -88,6 +453,18 @@ int Kronkjit::runOrcLazyJIT() {
 			    if (verifyModule(M, &dbgs())) {
 				    jitCompileFailure();
 			    }
+
+			    if (Attr::SPECULATE) {
+				    speculateCallees(*J.get(), M);
+			    }
+
+			    // the partitions live in contexts of their own, so the compile threads can optimize
+			    // them in parallel. Each needs its own target machine though.
+			    if (Attr::LAZY_OPTIMIZE and hasPipeline() and (not Cache->keyUnoptimizedPartition(M))) {
+				    auto JTMB = getJITTargetMachineBuilder(M.getTargetTriple());
+				    auto TM = ExitOnErr(JTMB.createTargetMachine());
+				    optimizeModule(M, TM.get());
+			    }
 		    });
 		    return TSM;
 	    });
@@ -99,10 +476,30 @@ int Kronkjit::runOrcLazyJIT() {
 	orc::LocalCXXRuntimeOverrides CXXRuntimeOverrides;
 	ExitOnErr(CXXRuntimeOverrides.enable(J->getMainJITDylib(), Mangle));
 
-	// Add the main module and the runtime.
+	std::unique_ptr<Kronktier> tiers;
+	if (Attr::TIERED) {
+		tiers = std::make_unique<Kronktier>(*J.get());
+		tiers->prepareModule(*MainModule.get());
+	}
+
+	// the default partitions hold a single function
+	if (Attr::JIT_PARTITION == "module") {
+		J->setPartitionFunction(orc::CompileOnDemandLayer::compileWholeModule);
+	}
+
+	else if (Attr::JIT_PARTITION == "scc") {
+		J->setPartitionFunction(getSCCPartitioner(*MainModule.get()));
+	}
+
+	// Add the main module and the runtime, unless the runtime was already linked into the main module
 	ExitOnErr(J->addLazyIRModule(orc::ThreadSafeModule(std::move(MainModule), TSCtx)));
-	Attr::Kronkrt->materializeAll();
-	ExitOnErr(J->addLazyIRModule(orc::ThreadSafeModule(std::move(Attr::Kronkrt), TSCtx)));
+
+	if (Attr::Kronkrt) {
+		ExitOnErr(Attr::Kronkrt->materializeAll());
+		ExitOnErr(J->addLazyIRModule(orc::ThreadSafeModule(std::move(Attr::Kronkrt), TSCtx)));
+	}
+
+	if (tiers) tiers->start();
 
 	// Run any static constructors.
 	ExitOnErr(J->runConstructors());
@@ -112,8 +509,11 @@ int Kronkjit::runOrcLazyJIT() {
 	using MainFnPtr = int (*)();
 
 	auto Main = reinterpret_cast<MainFnPtr>(static_cast<uintptr_t>(MainSym.getAddress()));
+
 	auto result = Main();
 
+	if (tiers) tiers->stop();
+
 	// Run destructors.
 	ExitOnErr(J->runDestructors());
 	CXXRuntimeOverrides.runDestructors();
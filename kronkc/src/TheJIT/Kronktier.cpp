@@ -0,0 +1,185 @@
+#include "Kronktier.h"
+
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include "Kronkjit.h"
+
+
+static ExitOnError ExitOnErr("FATAL ERROR");
+
+// how many entries and loop iterations make a function worth optimizing
+static const int64_t HotCount = 1 << 12;
+
+// how often the background thread looks at the counts
+static const auto PollInterval = std::chrono::milliseconds(10);
+
+
+// kronk functions are mangled (see names::mangleNameAsLocalFunction), unlike main and the runtime
+static bool isKronkFunction(const GlobalValue* GV) {
+	return isa<Function>(GV) and GV->getName().startswith("_Z");
+}
+
+
+// counts the entries into fn and the iterations of its loops, whose headers run once per iteration
+void Kronktier::countEntriesAndLoops(Function& fn, GlobalVariable* count) {
+	// the background thread reads the count as the program runs, and the compile threads may run the
+	// function on several threads too. Only the count itself matters, so the add is relaxed.
+	auto increment = [count](Instruction* insertPt) {
+		IRBuilder<> builder(insertPt);
+		builder.CreateAtomicRMW(AtomicRMWInst::Add, count, builder.getInt64(1),
+		                        AtomicOrdering::Monotonic);
+	};
+
+	DominatorTree DT(fn);
+	LoopInfo LI(DT);
+
+	increment(&*fn.getEntryBlock().getFirstInsertionPt());
+
+	for (auto loop : LI.getLoopsInPreorder()) {
+		increment(&*loop->getHeader()->getFirstInsertionPt());
+	}
+}
+
+
+void Kronktier::prepareModule(Module& M) {
+	targetTriple = M.getTargetTriple();
+
+	for (auto& fn : M) {
+		if (fn.isDeclaration() or (not isKronkFunction(&fn))) continue;
+
+		// the program was internalized, but the stubs must find the code of each tier by name
+		fn.setLinkage(GlobalValue::ExternalLinkage);
+		functions.push_back({ fn.getName().str() });
+	}
+
+	// the optimized code gets its own copy of the constant globals, but there must be only one of the
+	// others, like the arena of an inlined runtime or the reference count of the literals
+	for (auto& GV : M.globals()) {
+		if (GV.isConstant() or (not GV.hasLocalLinkage())) continue;
+
+		if (not GV.hasName()) GV.setName("kronk.tier.global");
+		GV.setLinkage(GlobalValue::ExternalLinkage);
+	}
+
+	raw_string_ostream bitcodeStream(programBitcode);
+	WriteBitcodeToFile(M, bitcodeStream);
+	bitcodeStream.flush();
+
+	for (auto& tiered : functions) {
+		auto fn = M.getFunction(tiered.name);
+
+		auto count = new GlobalVariable(M, Attr::Builder.getInt64Ty(), false, GlobalValue::ExternalLinkage,
+		                                Attr::Builder.getInt64(0), tiered.name + ".count");
+		countEntriesAndLoops(*fn, count);
+
+		// every call, recursive ones included, goes through the stub
+		auto stub = Function::Create(fn->getFunctionType(), GlobalValue::ExternalLinkage, "", M);
+		stub->setCallingConv(fn->getCallingConv());
+		stub->setAttributes(fn->getAttributes());
+
+		fn->replaceAllUsesWith(stub);
+		fn->setName(tiered.name + ".tier0");
+		stub->setName(tiered.name);
+	}
+
+	Stubs = orc::createLocalIndirectStubsManagerBuilder(Triple(targetTriple))();
+}
+
+
+void Kronktier::start() {
+	orc::MangleAndInterner Mangle(J.getExecutionSession(), J.getDataLayout());
+
+	// the stubs are defined before the tier 0 code is looked up, and before runOrcLazyJIT looks up main
+	// or runs the constructors, since any code compiled from then on may call them
+	orc::SymbolMap stubSymbols;
+	for (auto& tiered : functions) {
+		ExitOnErr(Stubs->createStub(tiered.name, 0, JITSymbolFlags::Exported | JITSymbolFlags::Callable));
+		stubSymbols[Mangle(tiered.name)] = Stubs->findStub(tiered.name, true);
+	}
+
+	ExitOnErr(J.getMainJITDylib().define(orc::absoluteSymbols(std::move(stubSymbols))));
+
+	for (auto& tiered : functions) {
+		// the tier 0 code is itself compiled lazily, on its first call
+		auto tier0 = ExitOnErr(J.lookup(tiered.name + ".tier0"));
+		ExitOnErr(Stubs->updatePointer(tiered.name, tier0.getAddress()));
+
+		auto count = ExitOnErr(J.lookup(tiered.name + ".count"));
+		tiered.count = reinterpret_cast<int64_t*>(static_cast<uintptr_t>(count.getAddress()));
+	}
+
+	worker = std::thread([this] { run(); });
+}
+
+
+void Kronktier::stop() {
+	isStopping = true;
+	if (worker.joinable()) worker.join();
+}
+
+
+void Kronktier::optimizeFunction(const Module& program, const std::string& name, TargetMachine& TM) {
+	LogProgress("Optimizing the hot function " + name);
+
+	// the other kronk functions are copied too so they can be inlined. They stay private to the optimized
+	// code, and GlobalDCE drops the ones that end up unused. Of the globals, only the constants are
+	// copied. The others are just declared, so the optimized code shares them with tier 0.
+	ValueToValueMapTy VMap;
+	auto hotModule = CloneModule(program, VMap, [](const GlobalValue* GV) {
+		auto var = dyn_cast<GlobalVariable>(GV);
+		bool isCopyable = isa<Function>(GV) or (var and var->isConstant());
+		return (GV->hasLocalLinkage() and isCopyable) or isKronkFunction(GV);
+	});
+
+	for (auto& fn : *hotModule) {
+		if (fn.isDeclaration()) continue;
+
+		if (fn.getName() == name) {
+			fn.setName(name + ".tier1");
+		}
+
+		else {
+			fn.setLinkage(GlobalValue::InternalLinkage);
+		}
+	}
+
+	Kronkjit::optimizeModule(*hotModule.get(), &TM);
+
+	ExitOnErr(J.addObjectFile(orc::SimpleCompiler(TM)(*hotModule.get())));
+
+	auto tier1 = ExitOnErr(J.lookup(name + ".tier1"));
+	ExitOnErr(Stubs->updatePointer(name, tier1.getAddress()));
+}
+
+
+void Kronktier::run() {
+	// the background thread has a context of its own, so it never races with the compile threads
+	LLVMContext context;
+
+	auto program = parseBitcodeFile(MemoryBufferRef(programBitcode, "program"), context);
+	if (not program) {
+		consumeError(program.takeError());
+		return;
+	}
+
+	// unlike the tier 0 code, the optimized code is compiled at the codegen level of -O
+	auto TM = ExitOnErr(Kronkjit::getJITTargetMachineBuilder(targetTriple).createTargetMachine());
+
+	while (not isStopping) {
+		for (auto& tiered : functions) {
+			if (isStopping) break;
+			if (tiered.isOptimized) continue;
+			if (__atomic_load_n(tiered.count, __ATOMIC_RELAXED) < HotCount) continue;
+
+			optimizeFunction(*program->get(), tiered.name, *TM.get());
+			tiered.isOptimized = true;
+		}
+
+		std::this_thread::sleep_for(PollInterval);
+	}
+}
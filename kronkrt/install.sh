@@ -1,7 +1,7 @@
 #!/bin/bash
 
-# for now all we do is copy the targets to the top level bin directory
+# for now all we do is copy the runtime bitcode to the top level bin directory
 # Meson runs this script from the build directory even though its not there
 
 target_dest=../../bin/
-rsync -t "$MESON_BUILD_ROOT"/src/* "$target_dest"
\ No newline at end of file
+rsync -t "$MESON_BUILD_ROOT"/src/libkronkrt.bc "$target_dest"
@@ -1,52 +1,51 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "fnattrs.h"
+
 
 // These are functions that may be used by kronkc during compilation. In the future they'll be
 // translated to kronk
 
 extern "C" {
 
-bool _kronk_idx_check(int64_t idx, int64_t listSize) {
-	return (idx >= 0) ? (idx < listSize) : (labs(idx) <= listSize);
-}
-
-
-void _kronk_list_idx_check(int64_t idx, int64_t listSize, const char* file, int64_t lineNumber) {
-	bool res = _kronk_idx_check(idx, listSize);
+KRT_ERROR_PATH
+void _kronk_rt_error(const char* file, int64_t lineNumber, const char* errMsg, int64_t listSize) {
+	printf("%s%s%s\n%s%" PRId64 "%s", "In ", file, ",", "[Line ", lineNumber, errMsg);
+	// errors that don't involve a liste pass a negative size
+	if (listSize >= 0) printf("%" PRId64, listSize);
 
-	if (not res) {
-		printf("%s%s%s\n%s%d%s%d\n", "In ", file, ",", "[Line ", lineNumber,
-		       "]: IndexError: while indexing liste of size ", listSize);
+	printf("\n");
 
-		exit(EXIT_FAILURE);
-	}
+	exit(EXIT_FAILURE);
 }
 
 
-void _kronk_list_slice_check(int64_t start, int64_t end, int64_t listSize, const char* file,
-                             int64_t lineNumber) {
-	bool res = (start > end) ? false
-	                         : (_kronk_idx_check(start, listSize) || (start == listSize)) &&
-	                               (_kronk_idx_check(end, listSize) || (end == listSize));
+// names of the files of the program. Emitted by kronkc when it links the program's modules
+extern const char* const _kronk_source_files[];
 
-	if (not res) {
-		printf("%s%s%s\n%s%d%s%d\n", "In ", file, ",", "[Line ", lineNumber,
-		       "]: SliceError: while slicing liste of size ", listSize);
 
-		exit(EXIT_FAILURE);
-	}
-}
+// the kinds of checks kronkc emits, see irGenAide::RtCheck
+enum RtCheck : int32_t { INDEX, SLICE, ZERO_DIVISION };
 
 
-int64_t _kronk_list_fix_idx(int64_t idx, int64_t listSize) { return (idx < 0) ? idx + listSize : idx; }
+// Called when a runtime check fails. site packs the index of the file in _kronk_source_files (upper 12
+// bits) and the line (lower 20 bits) of the check.
+KRT_ERROR_PATH
+void _kronk_rt_trap(int32_t kind, int32_t site, int64_t listSize) {
+	auto file = _kronk_source_files[static_cast<uint32_t>(site) >> 20];
+	int64_t lineNumber = site & 0xFFFFF;
 
+	switch (kind) {
+		case INDEX:
+			_kronk_rt_error(file, lineNumber, "]: IndexError: while indexing liste of size ", listSize);
 
-void _kronk_zero_div_check(double x, const char* file, int64_t lineNumber) {
-	if (x == 0) {
-		printf("%s%s%s\n%s%d%s\n", "In ", file, ",", "[Line ", lineNumber, "]: ZeroDivisionError ");
+		case SLICE:
+			_kronk_rt_error(file, lineNumber, "]: SliceError: while slicing liste of size ", listSize);
 
-		exit(EXIT_FAILURE);
+		default:
+			_kronk_rt_error(file, lineNumber, "]: ZeroDivisionError ", -1);
 	}
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,16 @@
+#ifndef _KRONKRT_FNATTRS_H
+#define _KRONKRT_FNATTRS_H
+
+// Function attributes that let the optimizer reason about calls into the runtime once it is linked with
+// a kronk program.
+
+// result only depends on the arguments (readnone, nounwind)
+#define KRT_PURE __attribute__((const, nothrow))
+
+// error paths. They never return, are rarely taken and shouldn't be inlined into the checks calling them
+#define KRT_ERROR_PATH __attribute__((cold, noreturn, noinline, nothrow))
+
+// allocators. The returned pointer doesn't alias any other pointer (noalias return)
+#define KRT_ALLOC __attribute__((malloc, nothrow))
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <cinttypes>
 #include <cstdarg>
 
 // Input Output functions
@@ -9,6 +10,7 @@ extern "C" {
 void _kio_afficher(const char* fmt, ...) {
 	bool val_bool;
 	double val_reel;
+	int64_t val_entier;
 	const char* str;
 	int64_t str_size;
 
@@ -27,6 +29,11 @@ void _kio_afficher(const char* fmt, ...) {
 				printf("%g ", val_reel);
 				break;
 
+			case 'e':
+				val_entier = va_arg(args, int64_t);
+				printf("%" PRId64 " ", val_entier);
+				break;
+
 			case 's':
 				str = va_arg(args, const char*);
 				if (*(fmt + 1) == 'd') {
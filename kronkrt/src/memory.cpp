@@ -0,0 +1,278 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fnattrs.h"
+
+
+// Region allocator for the lists, strings and entities kronkc can't put on the stack. Memory is bump
+// allocated from a stack of chunks. A function marks the arena when it is entered and releases
+// everything allocated after the mark before returning, so a loop building lists no longer grows the
+// stack and a big liste no longer overflows it.
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+// bigger objects get a chunk of their own, which is handed back to malloc as soon as it is released
+constexpr size_t LARGE_OBJECT_SIZE = CHUNK_SIZE / 4;
+constexpr size_t ALIGNMENT = 16;
+
+
+struct alignas(ALIGNMENT) Chunk {
+	Chunk* prev;
+	char* end;
+};
+
+Chunk* top = nullptr;
+char* bump = nullptr;
+// a released chunk is kept around, so calling a function in a loop doesn't malloc and free every time
+Chunk* spare = nullptr;
+
+// what the program allocated, reported at exit with --alloc-stats
+int64_t arenaAllocs = 0;
+int64_t arenaBytes = 0;
+int64_t heapAllocs = 0;
+int64_t heapBytes = 0;
+
+
+inline char* chunkData(Chunk* chunk) { return reinterpret_cast<char*>(chunk + 1); }
+
+
+Chunk* newChunk(size_t capacity) {
+	auto chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + capacity));
+	if (not chunk) {
+		printf("MemoryError: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	chunk->end = chunkData(chunk) + capacity;
+	return chunk;
+}
+
+
+void freeChunk(Chunk* chunk) {
+	if ((not spare) and (chunk->end - chunkData(chunk) == CHUNK_SIZE)) {
+		spare = chunk;
+		return;
+	}
+
+	free(chunk);
+}
+
+
+__attribute__((noinline)) void* allocSlow(size_t size) {
+	Chunk* chunk;
+	if (size > LARGE_OBJECT_SIZE) {
+		chunk = newChunk(size);
+	}
+
+	else if (spare) {
+		chunk = spare;
+		spare = nullptr;
+	}
+
+	else {
+		chunk = newChunk(CHUNK_SIZE);
+	}
+
+	chunk->prev = top;
+	top = chunk;
+	bump = chunkData(chunk) + size;
+
+	return chunkData(chunk);
+}
+
+}  // namespace
+
+
+extern "C" {
+
+KRT_ALLOC
+void* _kronk_alloc(int64_t size) {
+	size_t alignedSize = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	arenaAllocs++;
+	arenaBytes += alignedSize;
+
+	if (top and (alignedSize <= static_cast<size_t>(top->end - bump))) {
+		void* mem = bump;
+		bump += alignedSize;
+		return mem;
+	}
+
+	return allocSlow(alignedSize);
+}
+
+
+// the mark is the current bump pointer. It is null when nothing has been allocated yet
+void* _kronk_arena_mark() { return bump; }
+
+
+void _kronk_arena_release(void* mark) {
+	auto markPtr = static_cast<char*>(mark);
+
+	// pop the chunks allocated after the mark. A mark can't fall in a newer chunk, since each chunk's
+	// data starts after its header
+	while (top and not((chunkData(top) <= markPtr) and (markPtr <= top->end))) {
+		auto prev = top->prev;
+		freeChunk(top);
+		top = prev;
+	}
+
+	bump = (top) ? markPtr : nullptr;
+}
+
+
+// Called when the program ends if it was compiled with --alloc-stats. Goes to stderr so it doesn't mix
+// with what the program prints.
+void _kronk_print_alloc_stats() {
+	fprintf(stderr, "Allocations: %" PRId64 " in the arena (%" PRId64 " bytes), %" PRId64
+	                " on the heap (%" PRId64 " bytes)\n",
+	        arenaAllocs, arenaBytes, heapAllocs, heapBytes);
+}
+}
+
+
+// Listes. Their data blocks are allocated like any other memory, with extra care for the data blocks of
+// listes that may outlive the function that created them.
+
+namespace {
+
+// a liste as laid out by kronkc
+struct Liste {
+	int64_t size;
+	char* data;
+	int64_t capacity;
+	// number of listes sharing data. Null if this liste is the only one, unless data came from malloc
+	// (see HeapBlock)
+	int64_t* refs;
+};
+
+
+// Data blocks that come from malloc start with their reference count. Listes holding one always point
+// to it, so a liste can tell that it holds the only reference to a block it may free.
+struct alignas(ALIGNMENT) HeapBlock {
+	int64_t refs;
+};
+
+
+void* allocListMemory(size_t size, bool inArena) {
+	if (inArena) {
+		return _kronk_alloc(size);
+	}
+
+	heapAllocs++;
+	heapBytes += size;
+
+	void* mem = malloc((size) ? size : 1);
+	if (not mem) {
+		printf("MemoryError: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return mem;
+}
+
+
+// called when lst stops referring to its data block.
+void dropRef(Liste* lst) {
+	if (lst->refs) {
+		(*lst->refs)--;
+		lst->refs = nullptr;
+	}
+}
+
+
+// Whether the data block of lst came from malloc, starts at lst's first element, and isn't referred to
+// by any other liste. Counts are never too low, since listes only drop their reference when they move or
+// when they are slices that die.
+bool ownsHeapBlock(Liste* lst) {
+	return lst->refs and (*lst->refs == 1) and
+	       (reinterpret_cast<char*>(lst->refs) + sizeof(HeapBlock) == lst->data);
+}
+
+
+// Listes that don't outlive the function making the allocation move to the arena, others to malloc.
+void moveData(Liste* lst, int64_t elemSize, int64_t capacity, bool inArena) {
+	char* data;
+	int64_t* refs = nullptr;
+
+	if (inArena) {
+		data = static_cast<char*>(allocListMemory(capacity * elemSize, true));
+	}
+
+	else {
+		auto blockSize = sizeof(HeapBlock) + capacity * elemSize;
+		auto block = static_cast<HeapBlock*>(allocListMemory(blockSize, false));
+		block->refs = 1;
+		refs = &block->refs;
+		data = reinterpret_cast<char*>(block + 1);
+	}
+
+	memcpy(data, lst->data, lst->size * elemSize);
+
+	// listes that grow in a loop would otherwise leave every block they outgrew behind
+	if (ownsHeapBlock(lst)) {
+		free(lst->refs);
+	}
+
+	else {
+		dropRef(lst);
+	}
+
+	lst->data = data;
+	lst->capacity = capacity;
+	lst->refs = refs;
+}
+
+}  // namespace
+
+
+extern "C" {
+
+// Grows the data block of a liste so that it can hold at least minCapacity elements. The capacity is
+// at least doubled, so appending n elements one by one moves them O(log n) times. The old data block
+// is freed if lst was its only holder (see ownsHeapBlock), otherwise it's left to the listes still
+// reading from it.
+void _kronk_list_reserve(void* liste, int64_t elemSize, int64_t minCapacity, bool inArena) {
+	auto lst = static_cast<Liste*>(liste);
+	if (minCapacity <= lst->capacity) return;
+
+	int64_t capacity = (lst->capacity < 4) ? 4 : 2 * lst->capacity;
+	if (capacity < minCapacity) capacity = minCapacity;
+
+	moveData(lst, elemSize, capacity, inArena);
+}
+
+
+// Copy on write. Gives a liste that shares its data block its own copy of the elements.
+void _kronk_list_make_unique(void* liste, int64_t elemSize, bool inArena) {
+	auto lst = static_cast<Liste*>(liste);
+	if ((not lst->refs) or (*lst->refs <= 1)) return;
+
+	moveData(lst, elemSize, lst->size, inArena);
+}
+
+
+// Called the first time a liste's data block is shared with a copy or a slice. The copy or slice then
+// copies the pointer to the reference count.
+void _kronk_list_share(void* liste, bool inArena) {
+	auto lst = static_cast<Liste*>(liste);
+
+	if (lst->refs) {
+		(*lst->refs)++;
+		return;
+	}
+
+	lst->refs = static_cast<int64_t*>(allocListMemory(sizeof(int64_t), inArena));
+	*lst->refs = 2;
+}
+
+
+// Called when a slice dies, so the liste it was taken from can be modified without copying its elements
+// once nothing else refers to them. liste is null if the slice was never made.
+void _kronk_list_drop(void* liste) {
+	if (liste) dropRef(static_cast<Liste*>(liste));
+}
+}
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# runs every benchmark in bench/ once with the default kronkc flags and once with the flags given as
+# arguments, and reports the best of RUNS timings of both along with the speedup. Without arguments the
+# runtime is compared before and after inlining it, e.g
+#       ./run_bench.sh
+#       ./run_bench.sh --inline-runtime
+#       ./run_bench.sh --sans-verifications
+#       ./run_bench.sh --rapide-math
+#       ./run_bench.sh -O1 --time-passes
+#       ./run_bench.sh --tiered
+#       ./run_bench.sh --lazy-optimize --jit-partition scc --speculate
+
+RUNS=3
+FLAGS=("$@")
+[ ${#FLAGS[@]} -eq 0 ] && FLAGS=("--inline-runtime")
+
+# prints the best wall clock time of RUNS runs of kronkc with the given arguments
+best_time() {
+    best=""
+    for ((run = 0; run < RUNS; run++)); do
+        start=`date +%s.%N`
+        bin/kronkc "$@" > /dev/null
+        end=`date +%s.%N`
+
+        dt=$(echo "$end - $start" | bc -l)
+        if [ -z "$best" ] || (( $(echo "$dt < $best" | bc -l) )); then
+            best=$dt
+        fi
+    done
+    echo $best
+}
+
+printf "%-30s %10s %10s %8s\n" "" "default" "${FLAGS[*]}" "speedup"
+for bench in $(ls bench/); do
+    before=$(best_time bench/$bench)
+    after=$(best_time "${FLAGS[@]}" bench/$bench)
+
+    speedup=$(echo "$before / $after" | bc -l)
+    printf "%-30s %9.3fs %9.3fs %7.2fx\n" $bench "$before" "$after" "$speedup"
+done
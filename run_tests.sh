@@ -4,16 +4,43 @@ RED='\033[0;31m'
 GREEN='\033[0;32m'
 NC='\033[0m' # No Color
 
+# each test also runs in the compile modes that take a different path through the jit
+MODES=("" "--lazy-optimize" "--lazy-optimize --jit-partition scc --speculate" "--tiered"
+       "--tiered --inline-runtime")
+
 NUM_FAILED_TESTS=0
-for test in $(ls tests/); do
+for mode in "${MODES[@]}"; do
+    for test in $(ls tests/); do
+        out=$(bin/kronkc $mode $test)
+        failed=$(echo $out | tr ' ' '\n' | grep -c "faux")
+
+        if (($failed)); then
+            printf "%s %s ${RED}%s${NC}\n" $test "$mode" "FAILED"
+            ((NUM_FAILED_TESTS++))
+        else
+            printf "%s %s ${GREEN}%s${NC}\n" $test "$mode" "PASSED"
+        fi
+    done
+done
+
+# the hot function of test7 must be swapped for its optimized code before the program ends
+if bin/kronkc -d --tiered test7.krk | grep -q "Optimizing the hot function"; then
+    printf "%s %s ${GREEN}%s${NC}\n" test7.krk "--tiered (tier 1)" "PASSED"
+else
+    printf "%s %s ${RED}%s${NC}\n" test7.krk "--tiered (tier 1)" "FAILED"
+    ((NUM_FAILED_TESTS++))
+fi
+
+# programs that fail to compile or to run. The first line of each names the error it must report first
+for test in $(ls tests_erreurs/); do
+    expected=$(head -1 tests_erreurs/$test | sed 's/^# //')
     out=$(bin/kronkc $test)
-    failed=$(echo $out | tr ' ' '\n' | grep -c "faux")
 
-    if (($failed)); then
+    if echo "$out" | head -2 | grep -qF "$expected"; then
+        printf "%s ${GREEN}%s${NC}\n" $test "PASSED"
+    else
         printf "%s ${RED}%s${NC}\n" $test "FAILED"
         ((NUM_FAILED_TESTS++))
-    else
-        printf "%s ${GREEN}%s${NC}\n" $test "PASSED"
     fi
 done
 